@@ -16,6 +16,7 @@
 #include "util/OBJWriter.h"
 #include "util/PlyWriter.h"
 #include "util/TopFaceWriter.h"
+#include "util/VolumeLoader.h"
 
 GLWidget3D::GLWidget3D(MainWindow *parent) : QGLWidget(QGLFormat(QGL::SampleBuffers)) {
 	this->mainWin = parent;
@@ -312,13 +313,24 @@ void GLWidget3D::loadVoxelData(const QString& filename) {
 
 	// scan all the files in the directory to get a voxel data
 	QStringList files = dir.entryList(QDir::NoDotAndDotDot | QDir::Files, QDir::DirsFirst);
-	std::vector<cv::Mat_<uchar>> voxel_data(files.size());
+	std::vector<std::string> filenames(files.size());
 	for (int i = 0; i < files.size(); i++) {
-		voxel_data[i] = cv::imread((dir.absolutePath() + "/" + files[i]).toUtf8().constData(), cv::IMREAD_GRAYSCALE);
+		filenames[i] = (dir.absolutePath() + "/" + files[i]).toUtf8().constData();
 	}
-	vdb_size = cv::Point3i(voxel_data[0].cols, voxel_data[0].rows, voxel_data.size());
+	util::BinaryVolume volume;
+	try {
+		volume = util::VolumeLoader::loadBinary(filenames);
+	}
+	catch (const char* ex) {
+		std::cerr << ex << std::endl;
+		return;
+	}
+	vdb_size = cv::Point3i(volume.width, volume.height, volume.depth);
+
+	voxel_buildings = util::DisjointVoxelData::disjoint(volume);
 
-	voxel_buildings = util::DisjointVoxelData::disjoint(voxel_data);
+	// compute the IOUs between the adjacent slices once so that changing the layering threshold does not touch the voxels again
+	util::DisjointVoxelData::annotateIOUs(voxel_buildings);
 
 	show_mode = SHOW_INPUT;
 	update3DGeometry();
@@ -470,8 +482,8 @@ void GLWidget3D::update3DGeometry(const std::vector<util::VoxelBuilding>& voxel_
 	std::vector<Vertex> vertices;
 	for (int i = 0; i < voxel_buildings.size(); i++) {
 		for (int z = 0; z < voxel_buildings[i].node_stack.size(); z++) {
-			for (auto voxel_node : voxel_buildings[i].node_stack[z]) {
-				update3DGeometry(voxel_node, color, vertices);
+			for (int node : voxel_buildings[i].node_stack[z]) {
+				update3DGeometry(voxel_buildings[i].nodes[node], color, vertices);
 			}
 		}
 	}
@@ -485,18 +497,18 @@ void GLWidget3D::update3DGeometry(const std::vector<util::VoxelBuilding>& voxel_
 	renderManager.updateShadowMap(this, light_dir, light_mvpMatrix);
 }
 
-void GLWidget3D::update3DGeometry(const std::shared_ptr<util::VoxelNode>& voxel_node, glm::vec4& color, std::vector<Vertex>& vertices) {
-	std::vector<glm::dvec2> footprint(voxel_node->contour.contour.size());
-	for (int i = 0; i < voxel_node->contour.contour.size(); i++) {
-		cv::Point2f pt = voxel_node->contour.contour.getActualPoint(i);
+void GLWidget3D::update3DGeometry(const util::VoxelNode& voxel_node, glm::vec4& color, std::vector<Vertex>& vertices) {
+	std::vector<glm::dvec2> footprint(voxel_node.contour->contour.size());
+	for (int i = 0; i < voxel_node.contour->contour.size(); i++) {
+		cv::Point2f pt = voxel_node.contour->contour.getActualPoint(i);
 		footprint[i] = glm::dvec2(pt.x * scale, pt.y * scale);
 	}
-	std::vector<std::vector<glm::dvec2>> holes(voxel_node->contour.holes.size());
-	for (int i = 0; i < voxel_node->contour.holes.size(); i++) {
-		if (voxel_node->contour.holes[i].size() < 3) continue;
-		holes[i].resize(voxel_node->contour.holes[i].size());
-		for (int j = 0; j < voxel_node->contour.holes[i].size(); j++) {
-			cv::Point2f pt = voxel_node->contour.holes[i].getActualPoint(j);
+	std::vector<std::vector<glm::dvec2>> holes(voxel_node.contour->holes.size());
+	for (int i = 0; i < voxel_node.contour->holes.size(); i++) {
+		if (voxel_node.contour->holes[i].size() < 3) continue;
+		holes[i].resize(voxel_node.contour->holes[i].size());
+		for (int j = 0; j < voxel_node.contour->holes[i].size(); j++) {
+			cv::Point2f pt = voxel_node.contour->holes[i].getActualPoint(j);
 			holes[i][j] = glm::dvec2(pt.x * scale, pt.y * scale);
 		}
 	}
@@ -507,7 +519,7 @@ void GLWidget3D::update3DGeometry(const std::shared_ptr<util::VoxelNode>& voxel_
 		glutils::correct(holes[i]);
 	}
 
-	glm::mat4 mat = glm::translate(glm::mat4(), glm::vec3(0, 0, voxel_node->height * scale));
+	glm::mat4 mat = glm::translate(glm::mat4(), glm::vec3(0, 0, voxel_node.height * scale));
 	double h = scale;
 
 	// top face
@@ -2,6 +2,8 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <string>
+#include <stdexcept>
 #include <QDir>
 #include <QString>
 #include <QTextStream>
@@ -10,6 +12,8 @@
 #include "util/OBJWriter.h"
 #include "util/TopFaceWriter.h"
 #include "util/PlyWriter.h"
+#include "util/VolumeLoader.h"
+#include "util/LvoxFile.h"
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
@@ -59,6 +63,55 @@ QString readStringValue(const rapidjson::Value& node, const char* key) {
 	}
 }
 
+/**
+ * Return the full paths of the slice images in the directory in the sorted order.
+ */
+std::vector<std::string> listSliceFiles(const QDir& dir) {
+	QStringList files = dir.entryList(QDir::NoDotAndDotDot | QDir::Files, QDir::DirsFirst);
+	std::vector<std::string> filenames(files.size());
+	for (int i = 0; i < files.size(); i++) {
+		filenames[i] = (dir.absolutePath() + "/" + files[i]).toUtf8().constData();
+	}
+	return filenames;
+}
+
+/**
+ * Load the occupancy volume from the .lvox file, or from all the slice images in the directory of the given slice image.
+ */
+util::BinaryVolume loadVolume(const QString& input_filename, int voxel_value_threshold, int num_threads) {
+	QFileInfo finfo(input_filename);
+	if (finfo.suffix().toLower() == "lvox") {
+		util::lvox::LvoxVolume lvox_file(input_filename.toUtf8().constData());
+		return lvox_file.volume();
+	}
+	else {
+		return util::VolumeLoader::loadBinary(listSliceFiles(finfo.absoluteDir()), voxel_value_threshold, num_threads);
+	}
+}
+
+/**
+ * Return a function that reads the z-th slice from the .lvox file or from the slice images in the directory of the given slice image.
+ *
+ * @param input_filename		.lvox file or one of the slice images
+ * @param depth					the number of slices
+ * @param voxel_value_threshold	a voxel is occupied if its value is greater than this threshold
+ */
+std::function<cv::Mat_<uchar>(int)> sliceReader(const QString& input_filename, int& depth, int& voxel_value_threshold) {
+	QFileInfo finfo(input_filename);
+	if (finfo.suffix().toLower() == "lvox") {
+		std::shared_ptr<util::lvox::LvoxVolume> lvox_file = std::make_shared<util::lvox::LvoxVolume>(input_filename.toUtf8().constData());
+		depth = lvox_file->header.depth;
+		voxel_value_threshold = lvox_file->isBitPacked() ? 128 : lvox_file->header.voxel_value_threshold;
+		return [lvox_file](int z) { return lvox_file->slice(z); };
+	}
+	else {
+		std::vector<std::string> filenames = listSliceFiles(finfo.absoluteDir());
+		depth = filenames.size();
+		voxel_value_threshold = 128;
+		return [filenames](int z) { return util::VolumeLoader::loadSlice(filenames[z]); };
+	}
+}
+
 std::vector<double> readAlgorithmParams(rapidjson::Value& node, const QString& algorithm_name ) {
 	rapidjson::Value::ConstMemberIterator it = node.FindMember(algorithm_name.toUtf8().constData());
 	if (it != node.MemberEnd()) {
@@ -72,7 +125,10 @@ std::vector<double> readAlgorithmParams(rapidjson::Value& node, const QString& a
 			else if (algorithm_name == "right_angle") {
 				double epsilon = readNumber(alg, "epsilon", 20);
 				bool optimization = readBoolValue(alg, "optimization", true);
-				return{ epsilon, optimization ? 1.0 : 0.0 };
+				bool coarse_to_fine = readBoolValue(alg, "coarse_to_fine", false);
+				bool diagonal = readBoolValue(alg, "diagonal", false);
+				bool minimum_partition = alg.HasMember("decomposition") && readStringValue(alg, "decomposition") == "minimum";
+				return{ epsilon, optimization ? 1.0 : 0.0, coarse_to_fine ? 1.0 : 0.0, diagonal ? 1.0 : 0.0, minimum_partition ? 1.0 : 0.0 };
 			}
 			else if (algorithm_name == "curve") {
 				double epsilon = readNumber(alg, "epsilon", 16);
@@ -92,7 +148,59 @@ std::vector<double> readAlgorithmParams(rapidjson::Value& node, const QString& a
 }
 
 int main(int argc, const char* argv[]) {
-	if (argc == 2) {
+	if (argc >= 4 && std::string(argv[1]) == "--lvox") {
+		////////////////////////////////////////////////////////////////////////////////////
+		// convert the slice images into a single .lvox file
+		QFileInfo finfo(argv[2]);
+		if (!finfo.exists()) {
+			std::cerr << "Input file was not found: " << argv[2] << std::endl;
+			return -1;
+		}
+
+		// --raw may appear anywhere after the filenames, and the numbers are either all given or all omitted
+		std::vector<std::string> numbers;
+		bool raw = false;
+		for (int i = 4; i < argc; i++) {
+			if (std::string(argv[i]) == "--raw") raw = true;
+			else numbers.push_back(argv[i]);
+		}
+
+		double offset_x = 0.0;
+		double offset_y = 0.0;
+		double offset_z = 0.0;
+		double scale = 1.0;
+		try {
+			if (numbers.size() == 4) {
+				offset_x = std::stod(numbers[0]);
+				offset_y = std::stod(numbers[1]);
+				offset_z = std::stod(numbers[2]);
+				scale = std::stod(numbers[3]);
+			}
+			else if (numbers.size() != 0) {
+				throw std::invalid_argument("wrong number of arguments");
+			}
+		}
+		catch (const std::exception&) {
+			std::cerr << "Usage: \n" << argv[0] << " --lvox <slice image filename> <output lvox filename> [<offset_x> <offset_y> <offset_z> <scale>] [--raw]" << std::endl;
+			return -1;
+		}
+
+		try {
+			if (raw) {
+				std::vector<cv::Mat_<uchar>> voxel_data = util::VolumeLoader::load(listSliceFiles(finfo.absoluteDir()));
+				util::lvox::LvoxWriter::write(argv[3], voxel_data, 128, scale, offset_x, offset_y, offset_z);
+			}
+			else {
+				util::BinaryVolume volume = util::VolumeLoader::loadBinary(listSliceFiles(finfo.absoluteDir()));
+				util::lvox::LvoxWriter::write(argv[3], volume, 128, scale, offset_x, offset_y, offset_z);
+			}
+		}
+		catch (const char* ex) {
+			std::cerr << ex << std::endl;
+			return -1;
+		}
+	}
+	else if (argc == 2) {
 		////////////////////////////////////////////////////////////////////////////////////
 		// the new interface
 		QFile file(argv[1]);
@@ -104,7 +212,7 @@ int main(int argc, const char* argv[]) {
 		rapidjson::Document doc;
 		doc.Parse(in.readAll().toUtf8().constData());
 		
-		std::vector<cv::Mat_<uchar>> voxel_data;
+		util::BinaryVolume volume;
 		
 		// read input filename
 		bool do_voxel_model = readBoolValue(doc, "do_voxel_model", false);
@@ -139,20 +247,32 @@ int main(int argc, const char* argv[]) {
 			return -1;
 		}
 
-		// get directory
+		// check the input file
 		QFileInfo finfo(input_slice_filename);
 		if (!finfo.exists()) {
 			std::cerr << "Input file was not found: " << input_slice_filename.toUtf8().constData() << std::endl;
 			return -1;
 		}
-		QDir dir = finfo.absoluteDir();
 		
-		// scan all the files in the directory to get a voxel data
-		QStringList files = dir.entryList(QDir::NoDotAndDotDot | QDir::Files, QDir::DirsFirst);
-		voxel_data.resize(files.size());
-		for (int i = 0; i < files.size(); i++) {
-			voxel_data[i] = cv::imread((dir.absolutePath() + "/" + files[i]).toUtf8().constData(), cv::IMREAD_GRAYSCALE);
+		// read the number of threads (0 - use all the hardware threads)
+		int num_threads = readNumber(doc, "threads", 0);
+
+		// read the flag whether the slices are processed one by one instead of loading the whole volume
+		bool streaming = readBoolValue(doc, "streaming", false);
+
+		// read the .lvox file or scan all the files in the directory to get a voxel data
+		// (the debug voxel model has always treated the value 128 as occupied)
+		if (!streaming || do_voxel_model) {
+			try {
+				volume = loadVolume(input_slice_filename, do_voxel_model ? 127 : 128, num_threads);
+			}
+			catch (const char* ex) {
+				std::cerr << ex << std::endl;
+				return -1;
+			}
 		}
+		int width = volume.width;
+		int height = volume.height;
 		
 		// the following 4 parameters are necessary, we should throw an error if they are not provided, so removing defautl values.
 		
@@ -171,7 +291,7 @@ int main(int argc, const char* argv[]) {
 		// do voxel model (for debug)
 		if (do_voxel_model) {
 		  std::cout<< "Doing voxel model" << std::endl;
-		  voxel_model::voxel_model(voxel_data, output_mesh.toStdString(), offset_x, offset_y, offset_z, scale);
+		  voxel_model::voxel_model(volume, output_mesh.toStdString(), offset_x, offset_y, offset_z, scale);
 		  return 0;
 		}
 		
@@ -230,13 +350,33 @@ int main(int argc, const char* argv[]) {
 		catch (...) {
 		}
 
-		std::vector<util::VoxelBuilding> voxel_buildings = util::DisjointVoxelData::disjoint(voxel_data);
+		std::vector<util::VoxelBuilding> voxel_buildings;
+		if (streaming) {
+			try {
+				int depth;
+				int voxel_value_threshold;
+				std::function<cv::Mat_<uchar>(int)> read_slice = sliceReader(input_slice_filename, depth, voxel_value_threshold);
+				voxel_buildings = util::DisjointVoxelData::disjointStreaming(depth, [&](int z) {
+					cv::Mat_<uchar> slice = read_slice(z);
+					width = slice.cols;
+					height = slice.rows;
+					return slice;
+				}, voxel_value_threshold);
+			}
+			catch (const char* ex) {
+				std::cerr << ex << std::endl;
+				return -1;
+			}
+		}
+		else {
+			voxel_buildings = util::DisjointVoxelData::disjoint(volume, 0.1, num_threads);
+		}
 
 		std::vector<std::shared_ptr<util::BuildingLayer>> buildings;
-		buildings = simp::BuildingSimplification::simplifyBuildings(voxel_buildings, algorithms, false, min_layer_height, contour_simplification_weight, layering_threshold, contour_snapping_threshold, orientation, min_contour_area, max_obb_ratio, allow_triangle_contour, allow_overhang, min_hole_ratio);
+		buildings = simp::BuildingSimplification::simplifyBuildings(voxel_buildings, algorithms, false, min_layer_height, contour_simplification_weight, layering_threshold, contour_snapping_threshold, orientation, min_contour_area, max_obb_ratio, allow_triangle_contour, allow_overhang, min_hole_ratio, num_threads);
 
-		util::obj::OBJWriter::write(output_mesh.toUtf8().constData(), voxel_data[0].cols, voxel_data[0].rows, offset_x, offset_y, offset_z, scale, buildings);
-		util::topface::TopFaceWriter::write(output_top_face.toUtf8().constData(), voxel_data[0].cols, voxel_data[0].rows, offset_x, offset_y, offset_z, scale, buildings);
+		util::obj::OBJWriter::write(output_mesh.toUtf8().constData(), width, height, offset_x, offset_y, offset_z, scale, buildings);
+		util::topface::TopFaceWriter::write(output_top_face.toUtf8().constData(), width, height, offset_x, offset_y, offset_z, scale, buildings);
 
 		std::cout << buildings.size() << " buildings are generated." << std::endl;
 	}
@@ -244,6 +384,7 @@ int main(int argc, const char* argv[]) {
 		if (argc < 9) {
 			std::cerr << "Usage: \n" << argv[0] << " <slice image filename> <weight [0-1]> <algorithm option: 1 - All, 2 - DP> <offset_x> <offset_y> <offset_z> <scale> <output obj filename> <output topface filename>" << std::endl;
 			std::cerr << argv[0] << " <config json filename> " << std::endl;
+			std::cerr << argv[0] << " --lvox <slice image filename> <output lvox filename> [<offset_x> <offset_y> <offset_z> <scale>] [--raw]" << std::endl;
 			return -1;
 		}
 
@@ -265,26 +406,27 @@ int main(int argc, const char* argv[]) {
 		double scale = std::stod(argv[7]);
 
 		QString input_filename(argv[1]);
-		std::vector<cv::Mat_<uchar>> voxel_data;
+		util::BinaryVolume volume;
 
 		// The weight ratio of the accuracy term to the simplicity term for the cost function.
 		double alpha = std::stod(argv[2]);
 		alpha = std::min(std::max(0.0, alpha), 1.0);
 
-		// get directory
+		// check the input file
 		QFileInfo finfo(input_filename);
 		if (!finfo.exists()) {
 			std::cerr << "Input file was not found: " << argv[1] << std::endl;
 			return -1;
 		}
-		QDir dir = finfo.absoluteDir();
 
-		// scan all the files in the directory to get a voxel data
-		QStringList files = dir.entryList(QDir::NoDotAndDotDot | QDir::Files, QDir::DirsFirst);
-		voxel_data.resize(files.size());
-		for (int i = 0; i < files.size(); i++) {
-			voxel_data[i] = cv::imread((dir.absolutePath() + "/" + files[i]).toUtf8().constData(), cv::IMREAD_GRAYSCALE);
-		}	
+		// read the .lvox file or scan all the files in the directory to get a voxel data
+		try {
+			volume = loadVolume(input_filename, 128, 0);
+		}
+		catch (const char* ex) {
+			std::cerr << ex << std::endl;
+			return -1;
+		}
 		
 		// determine the layering threshold based on the weight ratio
 		double threshold = 0.01;
@@ -330,7 +472,7 @@ int main(int argc, const char* argv[]) {
 		double min_hole_ratio = 0.02;
 
 		time_t start = clock();
-		std::vector<util::VoxelBuilding> voxel_buildings = util::DisjointVoxelData::disjoint(voxel_data);
+		std::vector<util::VoxelBuilding> voxel_buildings = util::DisjointVoxelData::disjoint(volume);
 		time_t end = clock();
 		std::cout << "Time elapsed: " << (double)(end - start) / CLOCKS_PER_SEC << " sec." << std::endl;
 		
@@ -351,9 +493,9 @@ int main(int argc, const char* argv[]) {
 			buildings = simp::BuildingSimplification::simplifyBuildings(voxel_buildings, simp::BuildingSimplification::ALG_CURVE_RIGHTANGLE, record_stats, min_num_slices_per_layer, alpha, threshold, epsilon, resolution, curve_threshold, angle_threshold, min_hole_ratio);
 		}
 
-		util::obj::OBJWriter::write(std::string(argv[8]), voxel_data[0].cols, voxel_data[0].rows, offset_x, offset_y, offset_z, scale, buildings);
+		util::obj::OBJWriter::write(std::string(argv[8]), volume.width, volume.height, offset_x, offset_y, offset_z, scale, buildings);
 		if (topface_file.size() > 0) {
-			util::topface::TopFaceWriter::write(topface_file, voxel_data[0].cols, voxel_data[0].rows, offset_x, offset_y, offset_z, scale, buildings);
+			util::topface::TopFaceWriter::write(topface_file, volume.width, volume.height, offset_x, offset_y, offset_z, scale, buildings);
 		}
 
 		std::cout << buildings.size() << " buildings are generated." << std::endl;
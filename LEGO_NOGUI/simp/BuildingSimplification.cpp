@@ -6,6 +6,7 @@
 #include "CurveSimplification.h"
 #include "CurveRightAngleSimplification.h"
 #include "../util/EfficientRansacCurveDetector.h"
+#include <chrono>
 
 namespace simp {
 
@@ -23,37 +24,78 @@ namespace simp {
 	 * @param min_contour_area			Minimum area of the contour [pixel^2]. Note: the unit is already converted from m^2 to pixel^2.
 	 * @param allow_triangle_contour	True if a triangle is allowed as a simplified contour shape
 	 * @param min_hole_ratio			The minimum area ratio of a hole to the contour. If the area of the hole is too small, it will be removed.
+	 * @param num_threads				The number of threads to simplify the buildings and their components in parallel (0 - use all the hardware threads). The result does not depend on it.
 	 */
-	std::vector<std::shared_ptr<util::BuildingLayer>> BuildingSimplification::simplifyBuildings(std::vector<util::VoxelBuilding>& voxel_buildings, std::map<int, std::vector<double>>& algorithms, bool record_stats, int min_num_slices_per_layer, float alpha, float layering_threshold, float snapping_threshold, float orientation, float min_contour_area, float max_obb_ratio, bool allow_triangle_contour, bool allow_overhang, float min_hole_ratio) {
+	std::vector<std::shared_ptr<util::BuildingLayer>> BuildingSimplification::simplifyBuildings(std::vector<util::VoxelBuilding>& voxel_buildings, std::map<int, std::vector<double>>& algorithms, bool record_stats, int min_num_slices_per_layer, float alpha, float layering_threshold, float snapping_threshold, float orientation, float min_contour_area, float max_obb_ratio, bool allow_triangle_contour, bool allow_overhang, float min_hole_ratio, int num_threads) {
 		std::vector<std::shared_ptr<util::BuildingLayer>> buildings;
 
-		std::vector<std::tuple<float, long long, int>> records;
+		std::vector<std::tuple<float, long long, int, int>> records;
 
-		time_t start = clock();
+		auto start = std::chrono::steady_clock::now();
 		setbuf(stdout, NULL);
-		for (int i = 0; i < voxel_buildings.size(); i++) {
-			std::vector<std::shared_ptr<util::BuildingLayer>> components = util::DisjointVoxelData::layering(voxel_buildings[i], layering_threshold, min_num_slices_per_layer);
-			for (auto component : components) {
-				try {
-					// Better approach using efficient RANSAC
-					int height = component->getTopHeight();
-					bool curve_preferred = height < 121 && (component->top_height - component->bottom_height < 37) && component->top_height < 53 && util::EfficientRansacCurveDetector::detect2(component->raw_footprints);
-
-					/*
-					int height = component->getTopHeight();
-					bool curve_preferred = height < 121 && (component->top_height - component->bottom_height < 37) && component->top_height < 53 && util::EfficientRansacCurveDetector::detect(contours[0]);
-					*/
+		util::ThreadPool pool(num_threads);
+
+		// layer the buildings
+		std::vector<std::vector<std::shared_ptr<util::BuildingLayer>>> building_components(voxel_buildings.size());
+		pool.parallelFor(voxel_buildings.size(), [&](int i) {
+			building_components[i] = util::DisjointVoxelData::layering(voxel_buildings[i], layering_threshold, min_num_slices_per_layer);
+		});
+		std::cout << "Layering time " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms." << std::endl;
+
+		// Each component is simplified independently into its own slot,
+		// and the results are collected in the order of the buildings and the components.
+		std::vector<std::pair<int, std::shared_ptr<util::BuildingLayer>>> tasks;
+		for (int i = 0; i < building_components.size(); i++) {
+			for (auto component : building_components[i]) {
+				tasks.push_back({ i, component });
+			}
+		}
+		std::vector<std::shared_ptr<util::BuildingLayer>> task_buildings(tasks.size());
+		std::vector<std::vector<std::tuple<float, long long, int, int>>> task_records(tasks.size());
+		pool.parallelFor(tasks.size(), [&](int t) {
+			std::shared_ptr<util::BuildingLayer> component = tasks[t].second;
+			try {
+				// Better approach using efficient RANSAC
+				int height = component->getTopHeight();
+				bool curve_preferred = height < 121 && (component->top_height - component->bottom_height < 37) && component->top_height < 53 && util::EfficientRansacCurveDetector::detect2(component->raw_footprints);
 
-					std::shared_ptr<util::BuildingLayer> building;
-					building = simplifyBuildingByAll(i, component, {}, algorithms, alpha, snapping_threshold, orientation, min_contour_area, max_obb_ratio, allow_triangle_contour, allow_overhang, min_hole_ratio, curve_preferred, records);
+				/*
+				int height = component->getTopHeight();
+				bool curve_preferred = height < 121 && (component->top_height - component->bottom_height < 37) && component->top_height < 53 && util::EfficientRansacCurveDetector::detect(contours[0]);
+				*/
 
-					buildings.push_back(building);
+				task_buildings[t] = simplifyBuildingByAll(tasks[t].first, component, {}, algorithms, alpha, snapping_threshold, orientation, min_contour_area, max_obb_ratio, allow_triangle_contour, allow_overhang, min_hole_ratio, curve_preferred, task_records[t], pool);
+			}
+			catch (...) {
+				task_buildings[t].reset();
+			}
+		});
+
+		// The selected algorithms are reported here rather than in the tasks so that the lines do not interleave.
+		// The records of a task are in the order of the contours and the layers, which is the order of the serial run.
+		int num_evaluated = 0;
+		int num_skipped = 0;
+		for (int t = 0; t < tasks.size(); t++) {
+			if (task_buildings[t]) buildings.push_back(task_buildings[t]);
+			for (auto& record : task_records[t]) {
+				int selected_algorithm = std::get<2>(record);
+				num_evaluated += (int)algorithms.size() - std::get<3>(record);
+				num_skipped += std::get<3>(record);
+				if (selected_algorithm == ALG_RIGHTANGLE) {
+					std::cout << "Selected algorithm: RA" << std::endl;
+				}
+				else if (selected_algorithm == ALG_CURVE || selected_algorithm == ALG_CURVE_RIGHTANGLE) {
+					std::cout << "Selected algorithm: CSRA" << std::endl;
+				}
+				else {
+					std::cout << "Selected algorithm: DP" << std::endl;
 				}
-				catch (...) {}
 			}
+			records.insert(records.end(), task_records[t].begin(), task_records[t].end());
 		}
-		time_t end = clock();
-		std::cout << "Time elapsed " << (double)(end - start) / CLOCKS_PER_SEC << " sec." << std::endl;
+		auto end = std::chrono::steady_clock::now();
+		std::cout << "Time elapsed " << std::chrono::duration<double>(end - start).count() << " sec." << std::endl;
+		std::cout << "Evaluated algorithms: " << num_evaluated << ", skipped: " << num_skipped << std::endl;
 
 		if (record_stats) {
 			std::ofstream out("records.txt");
@@ -61,7 +103,8 @@ namespace simp {
 				float error = std::get<0>(records[i]);
 				long long num_primitive_shapes = std::get<1>(records[i]);
 				int selected_algorithm = std::get<2>(records[i]);
-				out << error << " " << num_primitive_shapes << " " << selected_algorithm << std::endl;
+				int num_skipped_algorithms = std::get<3>(records[i]);
+				out << error << " " << num_primitive_shapes << " " << selected_algorithm << " " << num_skipped_algorithms << std::endl;
 			}
 			out.close();
 		}
@@ -95,9 +138,10 @@ namespace simp {
 	 * @param orientation			The principle orientation of the building in radian
 	 * @param min_hole_ratio		The minimum area ratio of the hole to the contour
 	 * @param records				The statistics will be recorded.
+	 * @param pool					The thread pool to try the algorithms in parallel
 	 */
-	std::shared_ptr<util::BuildingLayer> BuildingSimplification::simplifyBuildingByAll(int building_id, std::shared_ptr<util::BuildingLayer> layer, const std::vector<util::Polygon>& parent_contours, std::map<int, std::vector<double>>& algorithms, float alpha, float snapping_threshold, float orientation, float min_contour_area, float max_obb_ratio, bool allow_triangle_contour, bool allow_overhang, float min_hole_ratio, bool curve_preferred, std::vector<std::tuple<float, long long, int>>& records) {
-		std::vector<util::Polygon> contours = layer->selectRepresentativeContours();
+	std::shared_ptr<util::BuildingLayer> BuildingSimplification::simplifyBuildingByAll(int building_id, std::shared_ptr<util::BuildingLayer> layer, const std::vector<util::Polygon>& parent_contours, std::map<int, std::vector<double>>& algorithms, float alpha, float snapping_threshold, float orientation, float min_contour_area, float max_obb_ratio, bool allow_triangle_contour, bool allow_overhang, float min_hole_ratio, bool curve_preferred, std::vector<std::tuple<float, long long, int, int>>& records, util::ThreadPool& pool) {
+		std::vector<util::Polygon> contours = layer->selectRepresentativeContours(pool);
 
 		// get baseline cost
 		std::vector<util::Polygon> baseline_polygons;
@@ -120,134 +164,55 @@ namespace simp {
 			float best_error = 0.0f;
 			int best_num_primitive_shapes = 0;
 
-			// try Douglas-Peucker
-			if (algorithms.find(ALG_DP) != algorithms.end()) {
-				try {
-					double epsilon = algorithms[ALG_DP][0];
-					util::Polygon simplified_polygon = DPSimplification::simplify(contours[i], epsilon, min_hole_ratio);
-					if (!util::isSimple(simplified_polygon.contour)) throw "Contour is self-intersecting.";
-
-					// check if the shape is a triangle
-					if (!allow_triangle_contour && simplified_polygon.contour.size() <= 3) throw "Triangle is not allowed.";
-
-					// check the OBB ratio
-					cv::Mat_<float> m;
-					cv::Rect obb = util::calculateOBB(simplified_polygon.contour.points, m);
-					if (obb.width == 0 || obb.height == 0 || obb.width / obb.height > max_obb_ratio || obb.height / obb.width > max_obb_ratio) throw "OBB ratio is exceeded the threshold.";
-
-					// calculate cost
-					std::vector<float> costs = calculateCost(simplified_polygon, contours[i], layer->top_height - layer->bottom_height);
-					float cost = alpha * costs[0] / costs[1] + (1 - alpha) * costs[2] / baseline_costs[2];
-					if (cost < best_cost) {
-						best_algorithm = ALG_DP;
-						right_angle_for_all_contours = false;
-						best_cost = cost;
-						best_simplified_polygon = simplified_polygon;
-
-						best_error = costs[0] / costs[1];
-						best_num_primitive_shapes = costs[2];
-					}
-				}
-				catch (...) {}
+			// The best one of the enabled algorithms is selected in the original order of DP, right angle, curve,
+			// and curve + right angle so that the ties are resolved as before.
+			std::vector<int> candidate_algorithms;
+			for (int algorithm : { ALG_DP, ALG_RIGHTANGLE, ALG_CURVE, ALG_CURVE_RIGHTANGLE }) {
+				if (algorithms.find(algorithm) != algorithms.end()) candidate_algorithms.push_back(algorithm);
 			}
-
-			// try right angle
-			if (algorithms.find(ALG_RIGHTANGLE) != algorithms.end()) {
+			std::vector<util::Polygon> candidate_polygons(candidate_algorithms.size());
+			std::vector<std::vector<float>> candidate_costs(candidate_algorithms.size());
+			std::vector<float> candidate_cost(candidate_algorithms.size(), std::numeric_limits<float>::max());
+			std::vector<char> candidate_valid(candidate_algorithms.size(), false);
+			auto evaluate = [&](int k) {
 				try {
-					int resolution = algorithms[ALG_RIGHTANGLE][0];
-					bool optimization = algorithms[ALG_RIGHTANGLE][1] > 0.0;
-					util::Polygon simplified_polygon = RightAngleSimplification::simplify(contours[i], resolution, orientation, min_hole_ratio, optimization);
-					if (!util::isSimple(simplified_polygon.contour)) throw "Contour is self-intersecting.";
-
-					// check if the shape is a triangle
-					if (!allow_triangle_contour && simplified_polygon.contour.size() <= 3) throw "Triangle is not allowed.";
-
-					// check the OBB ratio
-					cv::Mat_<float> m;
-					cv::Rect obb = util::calculateOBB(simplified_polygon.contour.points, m);
-					if (obb.width == 0 || obb.height == 0 || obb.width / obb.height > max_obb_ratio || obb.height / obb.width > max_obb_ratio) throw "OBB ratio is exceeded the threshold.";
-
-					// calculate cost
-					std::vector<float> costs = calculateCost(simplified_polygon, contours[i], layer->top_height - layer->bottom_height);
-					float cost = alpha * costs[0] / costs[1] + (1 - alpha) * costs[2] / baseline_costs[2];
-					if (curve_preferred) cost *= 2;
-					else cost *= 0.5;
-					if (cost < best_cost) {
-						best_algorithm = ALG_RIGHTANGLE;
-						best_cost = cost;
-						best_simplified_polygon = simplified_polygon;
-
-						best_error = costs[0] / costs[1];
-						best_num_primitive_shapes = costs[2];
-					}
+					candidate_cost[k] = evaluateAlgorithm(candidate_algorithms[k], algorithms.at(candidate_algorithms[k]), contours[i], layer->top_height - layer->bottom_height, baseline_costs, alpha, orientation, max_obb_ratio, allow_triangle_contour, min_hole_ratio, curve_preferred, candidate_polygons[k], candidate_costs[k], pool);
+					candidate_valid[k] = true;
 				}
 				catch (...) {}
+			};
+
+			// The algorithm of the lowest bound of the cost is evaluated first, and then the others are evaluated
+			// in parallel on the pool except those whose bounds cannot beat its cost, where the one earlier
+			// in the original order wins the ties.
+			std::vector<float> candidate_bounds(candidate_algorithms.size());
+			int first_k = 0;
+			for (int k = 0; k < candidate_algorithms.size(); k++) {
+				candidate_bounds[k] = lowerBoundOfCost(candidate_algorithms[k], algorithms.at(candidate_algorithms[k]), contours[i], baseline_costs, alpha, allow_triangle_contour, curve_preferred);
+				if (candidate_bounds[k] < candidate_bounds[first_k]) first_k = k;
 			}
 
-			// try curve
-			if (algorithms.find(ALG_CURVE) != algorithms.end()) {
-				try {
-					float epsilon = algorithms[ALG_CURVE][0];
-					float curve_threshold = algorithms[ALG_CURVE][1];
-					util::Polygon simplified_polygon = CurveSimplification::simplify(contours[i], epsilon, curve_threshold, orientation, min_hole_ratio);
-					if (!util::isSimple(simplified_polygon.contour)) throw "Contour is self-intersecting.";
-
-					// check if the shape is a triangle
-					if (!allow_triangle_contour && simplified_polygon.contour.size() <= 3) throw "Triangle is not allowed.";
-
-					// check the OBB ratio
-					cv::Mat_<float> m;
-					cv::Rect obb = util::calculateOBB(simplified_polygon.contour.points, m);
-					if (obb.width == 0 || obb.height == 0 || obb.width / obb.height > max_obb_ratio || obb.height / obb.width > max_obb_ratio) throw "OBB ratio is exceeded the threshold.";
-					
-					// calculate cost
-					std::vector<float> costs = calculateCost(simplified_polygon, contours[i], layer->top_height - layer->bottom_height);
-					float cost = alpha * costs[0] / costs[1] + (1 - alpha) * costs[2] / baseline_costs[2];
-					if (cost < best_cost) {
-						best_algorithm = ALG_CURVE;
-						right_angle_for_all_contours = false;
-						best_cost = cost;
-						best_simplified_polygon = simplified_polygon;
-
-						best_error = costs[0] / costs[1];
-						best_num_primitive_shapes = costs[2];
-					}
-				}
-				catch (...) {}
+			std::vector<int> remaining;
+			if (candidate_algorithms.size() > 0) evaluate(first_k);
+			for (int k = 0; k < candidate_algorithms.size(); k++) {
+				if (k == first_k) continue;
+				if (candidate_valid[first_k] && (candidate_bounds[k] > candidate_cost[first_k] || (candidate_bounds[k] == candidate_cost[first_k] && k > first_k))) continue;
+				remaining.push_back(k);
 			}
-
-			// try curve + right angle
-			if (algorithms.find(ALG_CURVE_RIGHTANGLE) != algorithms.end()) {
-				try {
-					float epsilon = algorithms[ALG_CURVE_RIGHTANGLE][0];
-					float curve_threshold = algorithms[ALG_CURVE_RIGHTANGLE][1];
-					float angle_threshold = algorithms[ALG_CURVE_RIGHTANGLE][2];
-					util::Polygon simplified_polygon = CurveRightAngleSimplification::simplify(contours[i], epsilon, curve_threshold, angle_threshold, orientation, min_hole_ratio);
-					if (!util::isSimple(simplified_polygon.contour)) throw "Contour is self-intersecting.";
-					
-					// check if the shape is a triangle
-					if (!allow_triangle_contour && simplified_polygon.contour.size() <= 3) throw "Triangle is not allowed.";
-
-					// check the OBB ratio
-					cv::Mat_<float> m;
-					cv::Rect obb = util::calculateOBB(simplified_polygon.contour.points, m);
-					if (obb.width == 0 || obb.height == 0 || obb.width / obb.height > max_obb_ratio || obb.height / obb.width > max_obb_ratio) throw "OBB ratio is exceeded the threshold.";
-
-					// calculate cost
-					std::vector<float> costs = calculateCost(simplified_polygon, contours[i], layer->top_height - layer->bottom_height);
-					float cost = alpha * costs[0] / costs[1] + (1 - alpha) * costs[2] / baseline_costs[2];
-					if (curve_preferred) cost *= 0.5;
-					if (cost < best_cost) {
-						best_algorithm = ALG_CURVE_RIGHTANGLE;
-						right_angle_for_all_contours = false;
-						best_cost = cost;
-						best_simplified_polygon = simplified_polygon;
-
-						best_error = costs[0] / costs[1];
-						best_num_primitive_shapes = costs[2];
-					}
+			int num_skipped = std::max(0, (int)candidate_algorithms.size() - 1 - (int)remaining.size());
+			pool.parallelFor(remaining.size(), [&](int r) { evaluate(remaining[r]); });
+
+			for (int k = 0; k < candidate_algorithms.size(); k++) {
+				if (!candidate_valid[k]) continue;
+				if (candidate_cost[k] < best_cost) {
+					best_algorithm = candidate_algorithms[k];
+					if (best_algorithm != ALG_RIGHTANGLE) right_angle_for_all_contours = false;
+					best_cost = candidate_cost[k];
+					best_simplified_polygon = candidate_polygons[k];
+
+					best_error = candidate_costs[k][0] / candidate_costs[k][1];
+					best_num_primitive_shapes = candidate_costs[k][2];
 				}
-				catch (...) {}
 			}
 
 			if (best_algorithm == ALG_UNKNOWN) {
@@ -275,16 +240,6 @@ namespace simp {
 
 			if (best_algorithm == ALG_UNKNOWN) continue;
 
-			if (best_algorithm == ALG_RIGHTANGLE) {
-				std::cout << "Selected algorithm: RA" << std::endl;
-			}
-			else if (best_algorithm == ALG_CURVE || best_algorithm == ALG_CURVE_RIGHTANGLE) {
-				std::cout << "Selected algorithm: CSRA" << std::endl;
-			}
-			else {
-				std::cout << "Selected algorithm: DP" << std::endl;
-			}
-
 			// snap the edges
 			if (parent_contours.size() > 0 && snapping_threshold > 0) {
 				if (best_algorithm == ALG_RIGHTANGLE) {
@@ -318,7 +273,7 @@ namespace simp {
 				best_simplified_polygons.push_back(best_simplified_polygon);
 			}
 
-			records.push_back(std::make_tuple(best_error, best_num_primitive_shapes, best_algorithm));
+			records.push_back(std::make_tuple(best_error, best_num_primitive_shapes, best_algorithm, num_skipped));
 		}
 
 
@@ -335,28 +290,132 @@ namespace simp {
 
 		std::shared_ptr<util::BuildingLayer> building = std::shared_ptr<util::BuildingLayer>(new util::BuildingLayer(building_id, best_simplified_polygons, layer->bottom_height, layer->top_height));
 
-		for (auto child_layer : layer->children) {
+		// The child layers depend only on the contours of this layer, so they are simplified in parallel,
+		// and their results and records are collected in the order of the children.
+		std::vector<std::shared_ptr<util::BuildingLayer>> children(layer->children.size());
+		std::vector<std::vector<std::tuple<float, long long, int, int>>> children_records(layer->children.size());
+		pool.parallelFor(layer->children.size(), [&](int c) {
+			std::shared_ptr<util::BuildingLayer> child_layer = layer->children[c];
 			try {
-				float contour_area = 0;
-				for (int i = 0; i < contours.size(); i++) {
-					contour_area += util::calculateArea(contours[i]);
-				}
-
-				float next_contour_area = 0;
-				for (int i = 0; i < child_layer->raw_footprints[0].size(); i++) {
-					next_contour_area += util::calculateArea(child_layer->raw_footprints[0][i]);
-				}
-
-				std::shared_ptr<util::BuildingLayer> child = simplifyBuildingByAll(building_id, child_layer, best_simplified_polygons, algorithms, alpha, snapping_threshold, orientation, min_contour_area, max_obb_ratio, allow_triangle_contour, allow_overhang, min_hole_ratio, curve_preferred, records);
-				building->children.push_back(child);
+				children[c] = simplifyBuildingByAll(building_id, child_layer, best_simplified_polygons, algorithms, alpha, snapping_threshold, orientation, min_contour_area, max_obb_ratio, allow_triangle_contour, allow_overhang, min_hole_ratio, curve_preferred, children_records[c], pool);
 			}
 			catch (...) {
+				children[c].reset();
 			}
+		});
+
+		for (int c = 0; c < children.size(); c++) {
+			if (children[c]) building->children.push_back(children[c]);
+			records.insert(records.end(), children_records[c].begin(), children_records[c].end());
 		}
 
 		return building;
 	}
 
+	/**
+	 * Simplify the contour by the specified algorithm and calculate the cost of the result.
+	 * An exception is thrown if the result is not a valid contour.
+	 *
+	 * @param algorithm				The simplification algorithm
+	 * @param params				The parameter values of the algorithm
+	 * @param contour				The contour to be simplified
+	 * @param height				The height of the layer
+	 * @param baseline_costs		The costs of the baseline simplification of the layer
+	 * @param simplified_polygon	[OUT] The simplified contour
+	 * @param costs					[OUT] The three values returned by calculateCost()
+	 * @param pool					The thread pool that the algorithm can use
+	 * @return						The cost, which is weighted by the preference of the algorithm
+	 */
+	float BuildingSimplification::evaluateAlgorithm(int algorithm, const std::vector<double>& params, const util::Polygon& contour, int height, const std::vector<float>& baseline_costs, float alpha, float orientation, float max_obb_ratio, bool allow_triangle_contour, float min_hole_ratio, bool curve_preferred, util::Polygon& simplified_polygon, std::vector<float>& costs, util::ThreadPool& pool) {
+		if (algorithm == ALG_DP) {
+			double epsilon = params[0];
+			simplified_polygon = DPSimplification::simplify(contour, epsilon, min_hole_ratio);
+		}
+		else if (algorithm == ALG_RIGHTANGLE) {
+			int resolution = params[0];
+			bool optimization = params[1] > 0.0;
+			bool coarse_to_fine = params.size() > 2 && params[2] > 0.0;
+			bool diagonal = params.size() > 3 && params[3] > 0.0;
+			bool minimum_partition = params.size() > 4 && params[4] > 0.0;
+			simplified_polygon = RightAngleSimplification::simplify(contour, resolution, orientation, min_hole_ratio, optimization, coarse_to_fine, diagonal, minimum_partition, &pool);
+		}
+		else if (algorithm == ALG_CURVE) {
+			float epsilon = params[0];
+			float curve_threshold = params[1];
+			simplified_polygon = CurveSimplification::simplify(contour, epsilon, curve_threshold, orientation, min_hole_ratio);
+		}
+		else if (algorithm == ALG_CURVE_RIGHTANGLE) {
+			float epsilon = params[0];
+			float curve_threshold = params[1];
+			float angle_threshold = params[2];
+			simplified_polygon = CurveRightAngleSimplification::simplify(contour, epsilon, curve_threshold, angle_threshold, orientation, min_hole_ratio);
+		}
+		else {
+			throw "Unknown algorithm.";
+		}
+		if (!util::isSimple(simplified_polygon.contour)) throw "Contour is self-intersecting.";
+
+		// check if the shape is a triangle
+		if (!allow_triangle_contour && simplified_polygon.contour.size() <= 3) throw "Triangle is not allowed.";
+
+		// check the OBB ratio
+		util::Affine m;
+		cv::Rect obb = util::calculateOBB(simplified_polygon.contour.points, m);
+		if (obb.width == 0 || obb.height == 0 || obb.width / obb.height > max_obb_ratio || obb.height / obb.width > max_obb_ratio) throw "OBB ratio is exceeded the threshold.";
+
+		// calculate cost
+		costs = calculateCost(simplified_polygon, contour, height);
+		float cost = alpha * costs[0] / costs[1] + (1 - alpha) * costs[2] / baseline_costs[2];
+		return cost * preferenceWeight(algorithm, curve_preferred);
+	}
+
+	/**
+	 * Return the factor by which the cost of the algorithm is multiplied according to the preference.
+	 */
+	float BuildingSimplification::preferenceWeight(int algorithm, bool curve_preferred) {
+		if (algorithm == ALG_RIGHTANGLE) {
+			if (curve_preferred) return 2;
+			else return 0.5;
+		}
+		else if (algorithm == ALG_CURVE_RIGHTANGLE) {
+			if (curve_preferred) return 0.5;
+		}
+		return 1;
+	}
+
+	/**
+	 * Return a lower bound of the cost that evaluateAlgorithm() can return for the algorithm without running it.
+	 * The error term is bounded by 0, and the simplicity term by the number of the vertices, which is at least 4
+	 * for the right angle simplification and when a triangle is not allowed, and 3 otherwise.
+	 * The vertices of DP are exactly those of approxPolyDP() with its epsilon, so their number is used for DP.
+	 * The curve algorithms re-trace and rectify the contour, so only the minimum number is sound for them.
+	 * The bound is evaluated in the same order of the float operations as the cost, so it does not exceed the cost
+	 * for the same number of vertices.
+	 *
+	 * @param algorithm				The simplification algorithm
+	 * @param params				The parameter values of the algorithm
+	 * @param contour				The contour to be simplified
+	 * @param baseline_costs		The costs of the baseline simplification of the layer
+	 * @param alpha					The weight balance between simplicity and accuracy
+	 * @param allow_triangle_contour	True if a triangle is allowed as a simplified contour shape
+	 * @param curve_preferred		True if the curve is preferred
+	 * @return						The lower bound of the cost
+	 */
+	float BuildingSimplification::lowerBoundOfCost(int algorithm, const std::vector<double>& params, const util::Polygon& contour, const std::vector<float>& baseline_costs, float alpha, bool allow_triangle_contour, bool curve_preferred) {
+		// no meaningful bound if the terms can be negative
+		if (alpha < 0 || alpha > 1 || !(baseline_costs[2] > 0)) return -std::numeric_limits<float>::max();
+
+		int num_vertices = (algorithm == ALG_RIGHTANGLE || !allow_triangle_contour) ? 4 : 3;
+		if (algorithm == ALG_DP) {
+			std::vector<cv::Point2f> simplified_contour;
+			util::approxPolyDP(contour.contour.points, simplified_contour, (float)params[0], true);
+			num_vertices = std::max(num_vertices, (int)simplified_contour.size());
+		}
+
+		float cost = (1 - alpha) * (float)num_vertices / baseline_costs[2];
+		return cost * preferenceWeight(algorithm, curve_preferred);
+	}
+
 	/**
 	 * Calculate cost for the layer/
 	 *
@@ -101,7 +101,7 @@ namespace simp {
 				cv::Mat_<uchar> img;
 				util::createImageFromPolygon(bbox.width, bbox.height, polygon, cv::Point2f(-bbox.x, -bbox.y), img);
 				float angle = orientation * 180 / CV_PI;
-				cv::Mat_<float> M;
+				util::Affine M;
 				polygon.contour.points = transform_angle(polygon.contour.points, M, angle);
 				//results_tmp = contour_rectify(polygon.contour.points, angle_threshold, epsilon);
 				results_tmp = contour_rectify_no_curve(polygon.contour.points, angle_threshold, epsilon);
@@ -177,7 +177,7 @@ namespace simp {
 				cv::Mat_<uchar> img;
 				util::createImageFromPolygon(bbox.width, bbox.height, polygon, cv::Point2f(-bbox.x, -bbox.y), img);
 				float angle = orientation * 180 / CV_PI;
-				cv::Mat_<float> M;
+				util::Affine M;
 				polygon.contour.points = transform_angle(polygon.contour.points, M, angle);
 				//results_tmp = contour_rectify(polygon.contour.points, angle_threshold, epsilon);
 				results_tmp = contour_rectify_no_curve(polygon.contour.points, angle_threshold, epsilon);
@@ -514,7 +514,7 @@ namespace simp {
 			//get maximal direction angle
 			float angle = orientation * 180 / CV_PI;
 			// transform
-			cv::Mat_<float> M;
+			util::Affine M;
 			final_contour = transform_angle(final_contour, M, angle);
 
 			// generate output polygon and decomposePolygon here
@@ -1022,7 +1022,7 @@ namespace simp {
 		return result;
 	}
 
-	std::vector<cv::Point2f> CurveRightAngleSimplification::transform_angle(std::vector<cv::Point2f> contour, cv::Mat_<float> &M, float angle){
+	std::vector<cv::Point2f> CurveRightAngleSimplification::transform_angle(const std::vector<cv::Point2f>& contour, util::Affine& M, float angle){
 		// computer the center of the contour
 		cv::Point2f center(0, 0);
 		for (int i = 0; i < contour.size(); i++){
@@ -1034,32 +1034,18 @@ namespace simp {
 		double theta = angle / 180 * CV_PI;
 
 		// create a transformation matrix
-		cv::Mat_<float> M_translate = (cv::Mat_<float>(3, 3) << 1, 0, center.x, 0, 1, center.y, 0, 0, 1);
-		cv::Mat_<float> M_rotate = (cv::Mat_<float>(3, 3) << cos(theta), -sin(theta), 0, sin(theta), cos(theta), 0, 0, 0, 1);
-		cv::Mat_<float> M_translate_inv = (cv::Mat_<float>(3, 3) << 1, 0, -center.x, 0, 1, -center.y, 0, 0, 1);
+		util::Affine M_translate = util::Affine::translation(center.x, center.y);
+		util::Affine M_rotate = util::Affine::rotation(theta);
+		util::Affine M_translate_inv = util::Affine::translation(-center.x, -center.y);
 		M = M_translate * M_rotate * M_translate_inv;
-		// create inverse transformation matrix
-		cv::Mat_<float> invM = M.inv();
 
 		// transform the polygon
-		std::vector<cv::Point2f> aa_contour(contour.size());
-		for (int i = 0; i < contour.size(); i++) {
-			cv::Mat_<float> p = (cv::Mat_<float>(3, 1) << contour[i].x, contour[i].y, 1);
-			cv::Mat_<float> p2 = M * p;
-			aa_contour[i] = cv::Point2f(p2(0, 0), p2(1, 0));
-		}
-		return aa_contour;
+		return M.transform(contour);
 	}
 
-	std::vector<cv::Point2f> CurveRightAngleSimplification::transform(std::vector<cv::Point2f> contour, cv::Mat_<float> M){
+	std::vector<cv::Point2f> CurveRightAngleSimplification::transform(const std::vector<cv::Point2f>& contour, const util::Affine& M){
 		// transform the polygon
-		std::vector<cv::Point2f> aa_contour(contour.size());
-		for (int i = 0; i < contour.size(); i++) {
-			cv::Mat_<float> p = (cv::Mat_<float>(3, 1) << contour[i].x, contour[i].y, 1);
-			cv::Mat_<float> p2 = M * p;
-			aa_contour[i] = cv::Point2f(p2(0, 0), p2(1, 0));
-		}
-		return aa_contour;
+		return M.transform(contour);
 	}
 
 	std::vector<cv::Point2f> CurveRightAngleSimplification::rectify_curves(std::vector<cv::Point2f> contour, std::vector<std::vector<cv::Point2f>> curves, std::vector<std::vector<cv::Point2f>> curves_attrs, std::vector<std::vector<cv::Point2f>>& curves_rectify, std::vector<std::vector<cv::Point2f>>& curves_attrs_rectify, float snap_threshold){
@@ -83,8 +83,8 @@ namespace simp {
 		static bool valid_curve(double threshold, const std::vector<cv::Point2d>& points, cv::Point2d center, double radius, cv::Rect bbox);
 		// new functions
 		static float axis_align(const cv::Mat_<uchar>& src);
-		static std::vector<cv::Point2f> transform_angle(std::vector<cv::Point2f> contour, cv::Mat_<float> &M, float angle);
-		static std::vector<cv::Point2f> transform(std::vector<cv::Point2f> contour, cv::Mat_<float> M);
+		static std::vector<cv::Point2f> transform_angle(const std::vector<cv::Point2f>& contour, util::Affine& M, float angle);
+		static std::vector<cv::Point2f> transform(const std::vector<cv::Point2f>& contour, const util::Affine& M);
 		static std::vector<cv::Point2f> rectify_curves(std::vector<cv::Point2f> contour, std::vector<std::vector<cv::Point2f>> curves, std::vector<std::vector<cv::Point2f>> curves_attrs, std::vector<std::vector<cv::Point2f>>& curves_rectify, std::vector<std::vector<cv::Point2f>>& curves_attrs_rectify, float snap_threshold);
 		static std::vector<cv::Point2f> del_redundant_points(std::vector<cv::Point2f> contour);
 		static std::vector<cv::Point2f> contour_rectify(std::vector<cv::Point2f>& contour, float threshold, float epsilon);
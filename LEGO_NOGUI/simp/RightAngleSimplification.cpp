@@ -1,5 +1,6 @@
 #include "RightAngleSimplification.h"
 #include "../util/ContourUtils.h"
+#include "../util/SummedAreaTable.h"
 
 namespace simp {
 
@@ -10,12 +11,16 @@ namespace simp {
 	* @param resolution		simplification is performed based on the resolution
 	* @param orientation	principle orientation of the contour in radian
 	* @param min_hole_ratio	hole will be removed if its area ratio to the contour is less than this threshold
+	* @param coarse_to_fine	if true, the offsets are searched on a coarse grid first and refined only around the best ones
+	* @param diagonal		if true, the orientation rotated by 45 degrees is also tried
+	* @param minimum_partition	if true, the footprint is decomposed into the minimum number of rectangles
+	* @param pool			thread pool to try the offsets in parallel (NULL - serial)
 	* @return				simplified footprint
 	*/
-	util::Polygon RightAngleSimplification::simplify(const util::Polygon& polygon, int resolution, float orientation, float min_hole_ratio, bool optimization) {
+	util::Polygon RightAngleSimplification::simplify(const util::Polygon& polygon, int resolution, float orientation, float min_hole_ratio, bool optimization, bool coarse_to_fine, bool diagonal, bool minimum_partition, util::ThreadPool* pool) {
 		util::Polygon ans;
 
-		std::tuple<float, int, int> best_mat = simplifyContour(polygon.contour, ans.contour, resolution, orientation, optimization);
+		std::tuple<float, int, int> best_mat = simplifyContour(polygon.contour, ans.contour, resolution, orientation, optimization, coarse_to_fine, diagonal, pool);
 		float angle = std::get<0>(best_mat);
 		float dx = std::get<1>(best_mat);
 		float dy = std::get<2>(best_mat);
@@ -44,61 +49,132 @@ namespace simp {
 		// ToDo:
 		// Should we check if the holes are inside the contour?
 
-		decomposePolygon(ans);
+		decomposePolygon(ans, minimum_partition);
 
 		return ans;
 	}
 
 	/**
 	* Simplify and regularize a polygon
+	* The offsets (dx, dy) on the grid of step resolution/10 are tried in parallel, and the best one is selected
+	* in the order of (angle, dx, dy) so that the result does not depend on the number of threads.
+	* In the coarse-to-fine mode, only every few offsets are tried first, and then the offsets around the best
+	* NUM_REFINED_OFFSETS coarse ones are tried. This may miss the best offset if the cost is not smooth.
 	*
 	* @param contour		input contour polygon
 	* @param result		output regularized polygon
 	* @param resolution	resolution which defines how much simplified
 	* @return				best angle, dx, and dy that yiled the resulting simplified polygon
 	*/
-	std::tuple<float, int, int> RightAngleSimplification::simplifyContour(const util::Ring& contour, util::Ring& result, int resolution, float orientation, bool optimization) {
+	std::tuple<float, int, int> RightAngleSimplification::simplifyContour(const util::Ring& contour, util::Ring& result, int resolution, float orientation, bool optimization, bool coarse_to_fine, bool diagonal, util::ThreadPool* pool) {
 		result.clear();
 
-		double min_cost = std::numeric_limits<double>::max();
-		float best_angle;
-		int best_dx;
-		int best_dy;
-
 		int step_size = std::max(1, resolution / 10);
-		//for (int angle_id = 0; angle_id < 2; angle_id++) {
-		for (int angle_id = 0; angle_id < 1; angle_id++) {
-			float angle = orientation + angle_id * 45.0 / 180.0 * CV_PI;
-
-			for (int dx = 0; dx < resolution; dx += step_size) {
-				for (int dy = 0; dy < resolution; dy += step_size) {
-					util::Ring simplified_contour;
-					try {
-						double cost = simplifyContour(contour, simplified_contour, resolution, angle, dx, dy, false, optimization);
-
-						if (cost < min_cost) {
-							min_cost = cost;
-							best_angle = angle;
-							best_dx = dx;
-							best_dy = dy;
-
-							result = simplified_contour;
+		int num_steps = (resolution + step_size - 1) / step_size;
+		int num_angles = diagonal ? 2 : 1;
+
+		// the contour is rotated once for each angle and translated for each offset
+		std::vector<float> angles(num_angles);
+		std::vector<std::vector<cv::Point2d>> rotated_contours(num_angles);
+		for (int angle_id = 0; angle_id < num_angles; angle_id++) {
+			angles[angle_id] = orientation + angle_id * 45.0 / 180.0 * CV_PI;
+			rotated_contours[angle_id] = rotateContour(contour.points, angles[angle_id]);
+		}
+
+		// candidate k is (angle_id, dx, dy) = (k / num_steps^2, (k / num_steps) % num_steps * step_size, k % num_steps * step_size)
+		int num_candidates = num_angles * num_steps * num_steps;
+		std::vector<double> costs(num_candidates, std::numeric_limits<double>::max());
+		std::vector<util::Ring> simplified_contours(num_candidates);
+		std::vector<char> tried(num_candidates, false);
+		util::ThreadPool serial_pool(1);
+		auto tryOffsets = [&](const std::vector<int>& candidates) {
+			(pool != NULL ? *pool : serial_pool).parallelFor(candidates.size(), [&](int i) {
+				int k = candidates[i];
+				int angle_id = k / (num_steps * num_steps);
+				int dx = (k / num_steps) % num_steps * step_size;
+				int dy = k % num_steps * step_size;
+				try {
+					costs[k] = simplifyRotatedContour(rotated_contours[angle_id], simplified_contours[k], resolution, angles[angle_id], dx, dy, false, optimization);
+				}
+				catch (...) {
+				}
+			});
+			for (int k : candidates) tried[k] = true;
+		};
+
+		if (!coarse_to_fine) {
+			std::vector<int> candidates(num_candidates);
+			for (int k = 0; k < num_candidates; k++) candidates[k] = k;
+			tryOffsets(candidates);
+		}
+		else {
+			int coarse_step = std::max(1, (int)std::round(std::sqrt((double)num_steps)));
+			std::vector<int> candidates;
+			for (int k = 0; k < num_candidates; k++) {
+				if ((k / num_steps) % num_steps % coarse_step == 0 && k % num_steps % coarse_step == 0) candidates.push_back(k);
+			}
+			tryOffsets(candidates);
+
+			// the offsets are periodic with the resolution, so the neighborhood wraps around
+			std::stable_sort(candidates.begin(), candidates.end(), [&costs](int a, int b) { return costs[a] < costs[b]; });
+			std::vector<int> fine_candidates;
+			for (int i = 0; i < candidates.size() && i < NUM_REFINED_OFFSETS; i++) {
+				int k = candidates[i];
+				if (costs[k] == std::numeric_limits<double>::max()) break;
+				int angle_id = k / (num_steps * num_steps);
+				for (int ix = -coarse_step + 1; ix < coarse_step; ix++) {
+					for (int iy = -coarse_step + 1; iy < coarse_step; iy++) {
+						int x = ((k / num_steps) % num_steps + ix + num_steps) % num_steps;
+						int y = (k % num_steps + iy + num_steps) % num_steps;
+						int k2 = (angle_id * num_steps + x) * num_steps + y;
+						if (!tried[k2]) {
+							tried[k2] = true;
+							fine_candidates.push_back(k2);
 						}
 					}
-					catch (...) {
-					}
 				}
 			}
+			tryOffsets(fine_candidates);
+		}
+
+		double min_cost = std::numeric_limits<double>::max();
+		int best_k = -1;
+		for (int k = 0; k < num_candidates; k++) {
+			if (costs[k] < min_cost) {
+				min_cost = costs[k];
+				best_k = k;
+			}
 		}
 
 		if (min_cost == std::numeric_limits<double>::max()) throw "No simplified polygon was found.";
 
+		float best_angle = angles[best_k / (num_steps * num_steps)];
+		int best_dx = (best_k / num_steps) % num_steps * step_size;
+		int best_dy = best_k % num_steps * step_size;
+		result = simplified_contours[best_k];
+
 		// refine the simplified contour
 		simplifyContour(contour, result, resolution, best_angle, best_dx, best_dy, true, optimization);
 
 		return std::make_tuple(best_angle, best_dx, best_dy);
 	}
 
+	/**
+	* Rotate the contour by theta.
+	* The coordinates are kept in double so that adding an offset and rounding them to float later
+	* gives exactly the same points as transforming them by util::Affine with the offset.
+	*/
+	std::vector<cv::Point2d> RightAngleSimplification::rotateContour(const std::vector<cv::Point2f>& contour, float theta) {
+		util::Affine R(cos(theta), -sin(theta), 0, sin(theta), cos(theta), 0);
+
+		std::vector<cv::Point2d> ans(contour.size());
+		for (int i = 0; i < contour.size(); i++) {
+			ans[i].x = (double)R.m00 * contour[i].x + (double)R.m01 * contour[i].y;
+			ans[i].y = (double)R.m10 * contour[i].x + (double)R.m11 * contour[i].y;
+		}
+		return ans;
+	}
+
 	/**
 	* Simplify and regularize a polygon using the specified angle, dx, and dy.
 	*
@@ -108,18 +184,28 @@ namespace simp {
 	* @return				best cost
 	*/
 	double RightAngleSimplification::simplifyContour(const util::Ring& contour, util::Ring& result, int resolution, float theta, int dx, int dy, bool refine, bool vertex_refinement) {
+		return simplifyRotatedContour(rotateContour(contour.points, theta), result, resolution, theta, dx, dy, refine, vertex_refinement);
+	}
+
+	/**
+	* Simplify and regularize a polygon that is already rotated by theta using the specified dx and dy.
+	*
+	* @param rotated_contour	input contour polygon rotated by rotateContour()
+	* @param result				output regularized polygon
+	* @param resolution			resolution which defines how much simplified
+	* @return					best cost
+	*/
+	double RightAngleSimplification::simplifyRotatedContour(const std::vector<cv::Point2d>& rotated_contour, util::Ring& result, int resolution, float theta, int dx, int dy, bool refine, bool vertex_refinement) {
 		// create a transformation matrix
-		cv::Mat_<float> M = (cv::Mat_<float>(3, 3) << cos(theta), -sin(theta), dx, sin(theta), cos(theta), dy, 0, 0, 1);
+		util::Affine M(cos(theta), -sin(theta), dx, sin(theta), cos(theta), dy);
 
 		// create inverse transformation matrix
-		cv::Mat_<float> invM = M.inv();
+		util::Affine invM = M.inv();
 
-		// transform the polygon
-		std::vector<cv::Point2f> aa_contour(contour.size());
-		for (int i = 0; i < contour.size(); i++) {
-			cv::Mat_<float> p = (cv::Mat_<float>(3, 1) << contour[i].x, contour[i].y, 1);
-			cv::Mat_<float> p2 = M * p;
-			aa_contour[i] = cv::Point2f(p2(0, 0), p2(1, 0));
+		// translate the rotated polygon
+		std::vector<cv::Point2f> aa_contour(rotated_contour.size());
+		for (int i = 0; i < rotated_contour.size(); i++) {
+			aa_contour[i] = cv::Point2f((float)(rotated_contour[i].x + M.m02), (float)(rotated_contour[i].y + M.m12));
 		}
 
 		// create the integer coordinates of the polygon
@@ -282,96 +368,126 @@ namespace simp {
 			}
 		}
 
-		// optimize the parameters
-		double best_score = 0;
-		std::map<int, int> best_x_map;
-		std::map<int, int> best_y_map;
+		// The image of a simple rectilinear contour consists of exactly the pixels whose centers are inside it,
+		// so moving a coordinate by one pixel only adds or removes the strips of pixels along the edges at the coordinate.
+		// In that case, the intersection and the union are updated from the summed-area table of the input image
+		// instead of rasterizing each proposed contour, which gives the same IOU.
+		util::SummedAreaTable table(img, cv::Point(min_x, min_y));
+		bool incremental = util::isSimple(simplified_contour);
+		std::map<int, std::vector<int>> x_edges;	// vertical edges at each x coordinate
+		std::map<int, std::vector<int>> y_edges;	// horizontal edges at each y coordinate
+		for (int i = 0; i < simplified_contour.size() && incremental; i++) {
+			const cv::Point& p1 = simplified_contour[i];
+			const cv::Point& p2 = simplified_contour[(i + 1) % simplified_contour.size()];
+			if (p1.x == p2.x && p1.y != p2.y) x_edges[p1.x].push_back(i);
+			else if (p1.y == p2.y && p1.x != p2.x) y_edges[p1.y].push_back(i);
+			else if (p1 != p2) incremental = false;
+		}
 
-		int cnt = 0;
-		for (int iter = 0; iter < 3000; iter++) {
-			bool updated = false;
+		long long area = 0;
+		long long inter = 0;
+		int orientation = 1;
+		if (incremental) {
+			table.measure(simplified_contour, area, inter);
+			orientation = util::SummedAreaTable::orientation(simplified_contour);
+		}
 
-			auto prev_it = x_map.end();
-			auto next_it = x_map.begin();
-			next_it++;
-			for (auto it = x_map.begin(); it != x_map.end(); it++) {
-				std::map<int, int> prop_x_map = x_map;
-				prop_x_map[it->first]++;
-				if ((next_it != x_map.end() && prop_x_map[it->first] <= prop_x_map[next_it->first]) || (next_it == x_map.end() && prop_x_map[it->first] <= max_x)) {
-					std::vector<cv::Point> proposed_contour = proposedContour(simplified_contour, prop_x_map, y_map);
-					cv::Mat_<uchar> img2;
-					util::createImageFromContour(max_x - min_x + 1, max_y - min_y + 1, proposed_contour, cv::Point(-min_x, -min_y), img2);
-					double score = util::calculateIOU(img, img2);
-					if (score > best_score) {
-						best_score = score;
-						best_x_map = prop_x_map;
-						best_y_map = y_map;
-						updated = true;
-					}
+		// Return the IOU of the contour whose coordinate "key" of the axis is moved to "value".
+		// The changes of the union and the intersection are returned in d_area and d_inter in the incremental mode.
+		auto score = [&](bool along_x, int key, int value, long long& d_area, long long& d_inter) {
+			if (!incremental) {
+				std::vector<cv::Point> proposed_contour(simplified_contour.size());
+				for (int i = 0; i < simplified_contour.size(); i++) {
+					proposed_contour[i] = cv::Point(x_map[simplified_contour[i].x], y_map[simplified_contour[i].y]);
+					if (along_x && simplified_contour[i].x == key) proposed_contour[i].x = value;
+					if (!along_x && simplified_contour[i].y == key) proposed_contour[i].y = value;
 				}
+				return table.rasterIOU(proposed_contour);
+			}
 
-				prop_x_map = x_map;
-				prop_x_map[it->first]--;
-				if ((prev_it != x_map.end() && prop_x_map[it->first] >= prop_x_map[prev_it->first]) || (prev_it == x_map.end() && prop_x_map[it->first] >= min_x)) {
-					std::vector<cv::Point> proposed_contour = proposedContour(simplified_contour, prop_x_map, y_map);
-					cv::Mat_<uchar> img2;
-					util::createImageFromContour(max_x - min_x + 1, max_y - min_y + 1, proposed_contour, cv::Point(-min_x, -min_y), img2);
-					double score = util::calculateIOU(img, img2);
-					if (score > best_score) {
-						best_score = score;
-						best_x_map = prop_x_map;
-						best_y_map = y_map;
-						updated = true;
-					}
+			d_area = 0;
+			d_inter = 0;
+			for (int i : (along_x ? x_edges : y_edges)[key]) {
+				const cv::Point& p1 = simplified_contour[i];
+				const cv::Point& p2 = simplified_contour[(i + 1) % simplified_contour.size()];
+				if (along_x) {
+					// the column of the pixels on the right of the edge is added, or the one on the left is removed
+					int y1 = y_map[p1.y];
+					int y2 = y_map[p2.y];
+					if (y1 == y2) continue;
+					int sign = (y2 > y1 ? 1 : -1) * orientation;
+					int col = value > x_map[key] ? x_map[key] : x_map[key] - 1;
+					if (value < x_map[key]) sign = -sign;
+					d_inter += sign * table.sum(col, std::min(y1, y2), col + 1, std::max(y1, y2));
+					d_area += sign * std::abs(y2 - y1);
 				}
-
-				prev_it = it;
-				if (next_it != x_map.end())	next_it++;
-			}
-
-			prev_it = y_map.end();
-			next_it = y_map.begin();
-			next_it++;
-			for (auto it = y_map.begin(); it != y_map.end(); it++) {
-				std::map<int, int> prop_y_map = y_map;
-				prop_y_map[it->first]++;
-				if ((next_it != y_map.end() && prop_y_map[it->first] <= prop_y_map[next_it->first]) || (next_it == y_map.end() && prop_y_map[it->first] <= max_y)) {
-					std::vector<cv::Point> proposed_contour = proposedContour(simplified_contour, x_map, prop_y_map);
-					cv::Mat_<uchar> img2;
-					util::createImageFromContour(max_x - min_x + 1, max_y - min_y + 1, proposed_contour, cv::Point(-min_x, -min_y), img2);
-					double score = util::calculateIOU(img, img2);
-					if (score > best_score) {
-						best_score = score;
-						best_x_map = x_map;
-						best_y_map = prop_y_map;
-						updated = true;
-					}
+				else {
+					// the row of the pixels below the edge is added, or the one above is removed
+					int x1 = x_map[p1.x];
+					int x2 = x_map[p2.x];
+					if (x1 == x2) continue;
+					int sign = (x2 < x1 ? 1 : -1) * orientation;
+					int row = value > y_map[key] ? y_map[key] : y_map[key] - 1;
+					if (value < y_map[key]) sign = -sign;
+					d_inter += sign * table.sum(std::min(x1, x2), row, std::max(x1, x2), row + 1);
+					d_area += sign * std::abs(x2 - x1);
 				}
+			}
+			return (double)(inter + d_inter) / (table.count + area + d_area - (inter + d_inter));
+		};
 
-				prop_y_map = y_map;
-				prop_y_map[it->first]--;
-				if ((prev_it != y_map.end() && prop_y_map[it->first] >= prop_y_map[prev_it->first]) || (prev_it == y_map.end() && prop_y_map[it->first] >= min_y)) {
-					std::vector<cv::Point> proposed_contour = proposedContour(simplified_contour, x_map, prop_y_map);
-					cv::Mat_<uchar> img2;
-					util::createImageFromContour(max_x - min_x + 1, max_y - min_y + 1, proposed_contour, cv::Point(-min_x, -min_y), img2);
-					double score = util::calculateIOU(img, img2);
-					if (score > best_score) {
-						best_score = score;
-						best_x_map = x_map;
-						best_y_map = prop_y_map;
-						updated = true;
+		// optimize the parameters
+		double best_score = 0;
+		bool best_along_x = true;
+		int best_key = 0;
+		int best_value = 0;
+		long long best_d_area = 0;
+		long long best_d_inter = 0;
+
+		for (int iter = 0; iter < 3000; iter++) {
+			bool updated = false;
+
+			for (int axis = 0; axis < 2; axis++) {
+				bool along_x = axis == 0;
+				std::map<int, int>& map = along_x ? x_map : y_map;
+				int lower = along_x ? min_x : min_y;
+				int upper = along_x ? max_x : max_y;
+
+				auto prev_it = map.end();
+				auto next_it = map.begin();
+				next_it++;
+				for (auto it = map.begin(); it != map.end(); it++) {
+					for (int step : { 1, -1 }) {
+						// the order of the coordinates must be kept
+						int value = it->second + step;
+						if (step > 0 && !((next_it != map.end() && value <= next_it->second) || (next_it == map.end() && value <= upper))) continue;
+						if (step < 0 && !((prev_it != map.end() && value >= prev_it->second) || (prev_it == map.end() && value >= lower))) continue;
+
+						long long d_area = 0;
+						long long d_inter = 0;
+						double s = score(along_x, it->first, value, d_area, d_inter);
+						if (s > best_score) {
+							best_score = s;
+							best_along_x = along_x;
+							best_key = it->first;
+							best_value = value;
+							best_d_area = d_area;
+							best_d_inter = d_inter;
+							updated = true;
+						}
 					}
-				}
 
-				prev_it = it;
-				if (next_it != y_map.end())	next_it++;
+					prev_it = it;
+					if (next_it != map.end()) next_it++;
+				}
 			}
 
 			// if no update, stop the optimization
 			if (!updated) break;
 
-			x_map = best_x_map;
-			y_map = best_y_map;
+			(best_along_x ? x_map : y_map)[best_key] = best_value;
+			area += best_d_area;
+			inter += best_d_inter;
 		}
 
 		simplified_contour = proposedContour(simplified_contour, x_map, y_map);
@@ -436,6 +552,14 @@ namespace simp {
 		cv::Mat_<uchar> img;
 		util::createImageFromContour(image_width, image_height, contour, cv::Point(-min_x, -min_y), img);
 
+		// The proposed contours are the simplified contour scaled along the axes, so they stay rectilinear and
+		// do not cross themselves if the simplified contour is simple. Then they are scored by the summed-area table.
+		util::SummedAreaTable table(img, cv::Point(min_x, min_y));
+		bool use_table = util::isSimple(simplified_contour);
+		auto evaluate = [&](const std::vector<cv::Point>& proposed_contour) {
+			return use_table ? table.calculateIOU(proposed_contour) : table.rasterIOU(proposed_contour);
+		};
+
 		// calculate the bounding box of the simplified contour
 		int x1 = std::numeric_limits<int>::max();
 		int x2 = -std::numeric_limits<int>::max();
@@ -456,9 +580,7 @@ namespace simp {
 		int best_y2 = y2;
 		{
 			std::vector<cv::Point> current_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, x1, x2, y1, y2);
-			cv::Mat_<uchar> img2;
-			util::createImageFromContour(image_width, image_height, current_contour, cv::Point(-min_x, -min_y), img2);
-			best_score = util::calculateIOU(img, img2);
+			best_score = evaluate(current_contour);
 		}
 
 		int cur_x1 = x1;
@@ -472,9 +594,7 @@ namespace simp {
 
 			{
 				std::vector<cv::Point> proposed_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, cur_x1 - 1, cur_x2, cur_y1, cur_y2);
-				cv::Mat_<uchar> img2;
-				util::createImageFromContour(image_width, image_height, proposed_contour, cv::Point(-min_x, -min_y), img2);
-				double score = util::calculateIOU(img, img2);
+				double score = evaluate(proposed_contour);
 				if (score > best_score) {
 					best_score = score;
 					best_x1 = cur_x1 - 1;
@@ -487,9 +607,7 @@ namespace simp {
 
 			{
 				std::vector<cv::Point> proposed_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, cur_x1 + 1, cur_x2, cur_y1, cur_y2);
-				cv::Mat_<uchar> img2;
-				util::createImageFromContour(image_width, image_height, proposed_contour, cv::Point(-min_x, -min_y), img2);
-				double score = util::calculateIOU(img, img2);
+				double score = evaluate(proposed_contour);
 				if (score > best_score) {
 					best_score = score;
 					best_x1 = cur_x1 + 1;
@@ -502,9 +620,7 @@ namespace simp {
 
 			{
 				std::vector<cv::Point> proposed_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, cur_x1, cur_x2 - 1, cur_y1, cur_y2);
-				cv::Mat_<uchar> img2;
-				util::createImageFromContour(image_width, image_height, proposed_contour, cv::Point(-min_x, -min_y), img2);
-				double score = util::calculateIOU(img, img2);
+				double score = evaluate(proposed_contour);
 				if (score > best_score) {
 					best_score = score;
 					best_x1 = cur_x1;
@@ -517,9 +633,7 @@ namespace simp {
 
 			{
 				std::vector<cv::Point> proposed_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, cur_x1, cur_x2 + 1, cur_y1, cur_y2);
-				cv::Mat_<uchar> img2;
-				util::createImageFromContour(image_width, image_height, proposed_contour, cv::Point(-min_x, -min_y), img2);
-				double score = util::calculateIOU(img, img2);
+				double score = evaluate(proposed_contour);
 				if (score > best_score) {
 					best_score = score;
 					best_x1 = cur_x1;
@@ -532,9 +646,7 @@ namespace simp {
 
 			{
 				std::vector<cv::Point> proposed_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, cur_x1, cur_x2, cur_y1 - 1, cur_y2);
-				cv::Mat_<uchar> img2;
-				util::createImageFromContour(image_width, image_height, proposed_contour, cv::Point(-min_x, -min_y), img2);
-				double score = util::calculateIOU(img, img2);
+				double score = evaluate(proposed_contour);
 				if (score > best_score) {
 					best_score = score;
 					best_x1 = cur_x1;
@@ -547,9 +659,7 @@ namespace simp {
 
 			{
 				std::vector<cv::Point> proposed_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, cur_x1, cur_x2, cur_y1 + 1, cur_y2);
-				cv::Mat_<uchar> img2;
-				util::createImageFromContour(image_width, image_height, proposed_contour, cv::Point(-min_x, -min_y), img2);
-				double score = util::calculateIOU(img, img2);
+				double score = evaluate(proposed_contour);
 				if (score > best_score) {
 					best_score = score;
 					best_x1 = cur_x1;
@@ -562,9 +672,7 @@ namespace simp {
 
 			{
 				std::vector<cv::Point> proposed_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, cur_x1, cur_x2, cur_y1, cur_y2 - 1);
-				cv::Mat_<uchar> img2;
-				util::createImageFromContour(image_width, image_height, proposed_contour, cv::Point(-min_x, -min_y), img2);
-				double score = util::calculateIOU(img, img2);
+				double score = evaluate(proposed_contour);
 				if (score > best_score) {
 					best_score = score;
 					best_x1 = cur_x1;
@@ -577,9 +685,7 @@ namespace simp {
 
 			{
 				std::vector<cv::Point> proposed_contour = proposedBBox(simplified_contour, x1, x2, y1, y2, cur_x1, cur_x2, cur_y1, cur_y2 + 1);
-				cv::Mat_<uchar> img2;
-				util::createImageFromContour(image_width, image_height, proposed_contour, cv::Point(-min_x, -min_y), img2);
-				double score = util::calculateIOU(img, img2);
+				double score = evaluate(proposed_contour);
 				if (score > best_score) {
 					best_score = score;
 					best_x1 = cur_x1;
@@ -611,7 +717,15 @@ namespace simp {
 		return prop_contour;
 	}
 
-	void RightAngleSimplification::decomposePolygon(util::Polygon& polygon) {
+	/**
+	 * Decompose the rectilinear polygon into rectangles, which are stored in primitive_shapes.
+	 * By default, the largest rectangle is taken greedily until the polygon is covered.
+	 *
+	 * @param polygon			polygon
+	 * @param minimum_partition	if true, the polygon is partitioned into the minimum number of rectangles
+	 * @return					false if the minimum partition was requested but the greedy decomposition was used instead
+	 */
+	bool RightAngleSimplification::decomposePolygon(util::Polygon& polygon, bool minimum_partition) {
 		// list up all xy coordinates
 		std::map<float, bool> x_map;
 		std::map<float, bool> y_map;
@@ -636,19 +750,43 @@ namespace simp {
 			y_coords.push_back(it->first);
 		}
 
-		std::vector<std::vector<bool>> grid(y_coords.size() - 1, std::vector<bool>(x_coords.size() - 1, false));
-		int cell_count = 0;
-		for (int i = 0; i < x_coords.size() - 1; i++) {
-			for (int j = 0; j < y_coords.size() - 1; j++) {
-				if (util::withinPolygon(cv::Point2f((x_coords[i] + x_coords[i + 1]) * 0.5, (y_coords[j] + y_coords[j + 1]) * 0.5), polygon)) {
-					grid[j][i] = true;
-					cell_count++;
+		// classify the cells by scanning the rows, or by testing their centers if the polygon is not rectilinear
+		std::vector<std::vector<bool>> grid;
+		bool scanned = classifyCells(polygon.contour, x_coords, y_coords, grid);
+		for (int i = 0; i < polygon.holes.size() && scanned; i++) {
+			std::vector<std::vector<bool>> hole_grid;
+			scanned = classifyCells(polygon.holes[i], x_coords, y_coords, hole_grid);
+			for (int j = 0; j < grid.size() && scanned; j++) {
+				for (int k = 0; k < grid[j].size(); k++) {
+					if (hole_grid[j][k]) grid[j][k] = false;
+				}
+			}
+		}
+		if (!scanned) {
+			grid.assign(y_coords.size() - 1, std::vector<bool>(x_coords.size() - 1, false));
+			for (int i = 0; i < x_coords.size() - 1; i++) {
+				for (int j = 0; j < y_coords.size() - 1; j++) {
+					if (util::withinPolygon(cv::Point2f((x_coords[i] + x_coords[i + 1]) * 0.5, (y_coords[j] + y_coords[j + 1]) * 0.5), polygon)) {
+						grid[j][i] = true;
+					}
 				}
 			}
 		}
+		int cell_count = 0;
+		for (int j = 0; j < grid.size(); j++) {
+			cell_count += std::count(grid[j].begin(), grid[j].end(), true);
+		}
 
 		polygon.primitive_shapes.clear();
 
+		std::vector<cv::Rect> rectangles;
+		if (minimum_partition && findMinimumPartition(grid, rectangles)) {
+			for (auto& rect : rectangles) {
+				polygon.primitive_shapes.push_back(boost::shared_ptr<util::PrimitiveShape>(new util::PrimitiveRectangle(polygon.mat, cv::Point2f(x_coords[rect.x], y_coords[rect.y]), cv::Point2f(x_coords[rect.x + rect.width], y_coords[rect.y + rect.height]))));
+			}
+			return true;
+		}
+
 		while (cell_count > 0) {
 			int x, y, width, height;
 			findMaximumRectangle(grid, x_coords, y_coords, x, y, width, height);
@@ -663,6 +801,8 @@ namespace simp {
 
 			polygon.primitive_shapes.push_back(boost::shared_ptr<util::PrimitiveShape>(new util::PrimitiveRectangle(polygon.mat, cv::Point2f(x_coords[x], y_coords[y]), cv::Point2f(x_coords[x + width], y_coords[y + height]))));
 		}
+
+		return !minimum_partition;
 	}
 
 	/**
@@ -779,39 +919,325 @@ namespace simp {
 		}
 	}
 
+	/**
+	 * Classify the cells of the grid whose corners are at x_coords and y_coords by whether their centers are inside the ring.
+	 * Each vertical edge of the ring changes the winding number of the cells on its left in the rows that it spans,
+	 * so a scan of each row from the right gives the winding numbers of all the cells at once.
+	 * A cell is inside if its winding number is not zero, which is what withinPolygon() returns for its center.
+	 *
+	 * @param ring		ring
+	 * @param x_coords	sorted x coordinates of the vertices
+	 * @param y_coords	sorted y coordinates of the vertices
+	 * @param inside	[OUT] inside[j][i] is true if the cell (i, j) is inside the ring
+	 * @return			false if the ring has an edge that is not axis aligned or a cell center is not strictly between its corners
+	 */
+	bool RightAngleSimplification::classifyCells(const util::Ring& ring, const std::vector<float>& x_coords, const std::vector<float>& y_coords, std::vector<std::vector<bool>>& inside) {
+		// the centers are computed as in the point-in-polygon test
+		for (int i = 0; i < x_coords.size() - 1; i++) {
+			float cx = (x_coords[i] + x_coords[i + 1]) * 0.5;
+			if (cx <= x_coords[i] || cx >= x_coords[i + 1]) return false;
+		}
+		for (int j = 0; j < y_coords.size() - 1; j++) {
+			float cy = (y_coords[j] + y_coords[j + 1]) * 0.5;
+			if (cy <= y_coords[j] || cy >= y_coords[j + 1]) return false;
+		}
+
+		// winding[j][k] is the change of the winding number at the k-th x coordinate in the j-th row
+		std::vector<std::vector<int>> winding(y_coords.size() - 1, std::vector<int>(x_coords.size(), 0));
+		for (int i = 0; i < ring.size(); i++) {
+			const cv::Point2f& p1 = ring[i];
+			const cv::Point2f& p2 = ring[(i + 1) % ring.size()];
+			if (p1.x != p2.x) {
+				if (p1.y != p2.y) return false;
+				continue;
+			}
+			if (p1.y == p2.y) continue;
+
+			int k = std::lower_bound(x_coords.begin(), x_coords.end(), p1.x) - x_coords.begin();
+			int j1 = std::lower_bound(y_coords.begin(), y_coords.end(), std::min(p1.y, p2.y)) - y_coords.begin();
+			int j2 = std::lower_bound(y_coords.begin(), y_coords.end(), std::max(p1.y, p2.y)) - y_coords.begin();
+			int sign = p2.y > p1.y ? 1 : -1;
+			for (int j = j1; j < j2; j++) {
+				winding[j][k] += sign;
+			}
+		}
+
+		inside.assign(y_coords.size() - 1, std::vector<bool>(x_coords.size() - 1, false));
+		for (int j = 0; j < inside.size(); j++) {
+			int w = 0;
+			for (int i = x_coords.size() - 2; i >= 0; i--) {
+				w += winding[j][i + 1];
+				inside[j][i] = w != 0;
+			}
+		}
+
+		return true;
+	}
+
+	/**
+	 * Find the rectangle of the largest area that consists of the true cells of the grid.
+	 * The heights of the runs of true cells that end at each row form a histogram, and a stack over it lists
+	 * the rectangles that cannot be extended to the left, right, or top, one of which has the largest area.
+	 * The rectangle that the exhaustive search in the order of (top, left, bottom, right) would find first
+	 * is returned, so that the decomposition does not depend on how the search is done.
+	 *
+	 * @param grid		grid of cells
+	 * @param x_coords	x coordinates of the cell corners
+	 * @param y_coords	y coordinates of the cell corners
+	 * @param x			[OUT] index of the left column of the rectangle
+	 * @param y			[OUT] index of the top row of the rectangle
+	 * @param width		[OUT] number of the columns of the rectangle
+	 * @param height	[OUT] number of the rows of the rectangle
+	 */
 	void RightAngleSimplification::findMaximumRectangle(const std::vector<std::vector<bool>>& grid, const std::vector<float>& x_coords, const std::vector<float>& y_coords, int& x, int& y, int& width, int& height) {
+		if (grid.size() == 0) return;
+		int cols = grid[0].size();
+
+		// find the largest area and the first top left corner of the rectangles that have it
 		float max_area = 0;
-		
-		for (int r = 0; r < grid.size(); r++) {
-			for (int c = 0; c < grid[r].size(); c++) {
-
-				for (int r2 = r; r2 < grid.size(); r2++) {
-					if (!grid[r2][c]) break;
-
-					for (int c2 = c; c2 < grid[r2].size(); c2++) {
-						// check the validity
-						bool valid = true;
-						for (int r3 = r; r3 <= r2; r3++) {
-							if (!grid[r3][c2]) {
-								valid = false;
-								break;
-							}
-						}
+		int top = -1;
+		int left = -1;
+		std::vector<int> heights(cols, 0);
+		std::vector<std::pair<int, int>> stack;
+		for (int r2 = 0; r2 < grid.size(); r2++) {
+			for (int c = 0; c < cols; c++) {
+				heights[c] = grid[r2][c] ? heights[c] + 1 : 0;
+			}
 
-						if (!valid) break;
+			stack.clear();
+			for (int c = 0; c <= cols; c++) {
+				int h = c < cols ? heights[c] : 0;
+				int start = c;
+				while (!stack.empty() && stack.back().second > h) {
+					int c1 = stack.back().first;
+					int r1 = r2 - stack.back().second + 1;
+					stack.pop_back();
+					start = c1;
+
+					float area = (x_coords[c] - x_coords[c1]) * (y_coords[r2 + 1] - y_coords[r1]);
+					if (area > max_area || (area == max_area && area > 0 && (r1 < top || (r1 == top && c1 < left)))) {
+						max_area = area;
+						top = r1;
+						left = c1;
+					}
+				}
+				if (h > 0 && (stack.empty() || stack.back().second < h)) {
+					stack.push_back(std::make_pair(start, h));
+				}
+			}
+		}
+		if (top < 0) return;
+
+		// find the first bottom right corner from the top left corner
+		int max_width = cols - left;
+		for (int r2 = top; r2 < grid.size(); r2++) {
+			int run = 0;
+			while (run < max_width && grid[r2][left + run]) run++;
+			max_width = run;
+			if (max_width == 0) break;
+
+			for (int c2 = left; c2 < left + max_width; c2++) {
+				float area = (x_coords[c2 + 1] - x_coords[left]) * (y_coords[r2 + 1] - y_coords[top]);
+				if (area == max_area) {
+					x = left;
+					y = top;
+					width = c2 - left + 1;
+					height = r2 - top + 1;
+					return;
+				}
+			}
+		}
+	}
 
-						float area = (x_coords[c2 + 1] - x_coords[c]) * (y_coords[r2 + 1] - y_coords[r]);
-						if (area > max_area) {
-							max_area = area;
-							x = c;
-							y = r;
-							width = c2 - c + 1;
-							height = r2 - r + 1;
-						}
+	/**
+	 * Partition the true cells of the grid into the minimum number of rectangles.
+	 * A chord is an axis aligned segment inside the polygon that connects two concave vertices. The partition is obtained
+	 * by drawing the maximum set of the chords that do not intersect each other, which is the maximum independent set of
+	 * the bipartite graph of the horizontal and vertical chords and is found from its maximum matching,
+	 * and then by drawing a horizontal segment from each remaining concave vertex until it hits the boundary or a segment.
+	 *
+	 * @param grid			grid of cells
+	 * @param rectangles	[OUT] rectangles in the indices of the cells
+	 * @return				false if a piece of the partition is not a rectangle, which happens only for degenerate grids
+	 */
+	bool RightAngleSimplification::findMinimumPartition(const std::vector<std::vector<bool>>& grid, std::vector<cv::Rect>& rectangles) {
+		int rows = grid.size();
+		int cols = rows > 0 ? grid[0].size() : 0;
+		auto inside = [&](int r, int c) { return r >= 0 && r < rows && c >= 0 && c < cols && grid[r][c]; };
+
+		// the edge between the grid points (i, j) and (i + 1, j) or (i, j + 1) is interior if the cells on both sides are inside
+		auto interiorH = [&](int i, int j) { return inside(j - 1, i) && inside(j, i); };
+		auto interiorV = [&](int i, int j) { return inside(j, i - 1) && inside(j, i); };
+
+		// list up the concave vertices, i.e., the grid points that have exactly three cells inside around them,
+		// with the horizontal and vertical directions to the interior
+		std::vector<cv::Point> concave_vertices;
+		std::vector<cv::Point> directions;
+		std::vector<std::vector<int>> vertex_ids(rows + 1, std::vector<int>(cols + 1, -1));
+		for (int j = 1; j < rows; j++) {
+			for (int i = 1; i < cols; i++) {
+				int num_inside = (inside(j - 1, i - 1) ? 1 : 0) + (inside(j - 1, i) ? 1 : 0) + (inside(j, i - 1) ? 1 : 0) + (inside(j, i) ? 1 : 0);
+				if (num_inside != 3) continue;
+
+				vertex_ids[j][i] = concave_vertices.size();
+				concave_vertices.push_back(cv::Point(i, j));
+				directions.push_back(cv::Point(inside(j - 1, i - 1) && inside(j, i - 1) ? -1 : 1, inside(j - 1, i - 1) && inside(j - 1, i) ? -1 : 1));
+			}
+		}
+
+		// find the chords by walking from each concave vertex to the right or downward
+		std::vector<cv::Vec4i> h_chords;	// (x1, x2, y, unused)
+		std::vector<cv::Vec4i> v_chords;	// (y1, y2, x, unused)
+		for (int k = 0; k < concave_vertices.size(); k++) {
+			int i = concave_vertices[k].x;
+			int j = concave_vertices[k].y;
+			if (directions[k].x > 0) {
+				int i2 = i;
+				while (interiorH(i2, j)) i2++;
+				if (vertex_ids[j][i2] >= 0) h_chords.push_back(cv::Vec4i(i, i2, j, 0));
+			}
+			if (directions[k].y > 0) {
+				int j2 = j;
+				while (interiorV(i, j2)) j2++;
+				if (vertex_ids[j2][i] >= 0) v_chords.push_back(cv::Vec4i(j, j2, i, 0));
+			}
+		}
+
+		// build the bipartite graph of the intersecting chords, where the chords that share an end point also intersect
+		std::vector<std::vector<int>> adj(h_chords.size());
+		for (int h = 0; h < h_chords.size(); h++) {
+			for (int v = 0; v < v_chords.size(); v++) {
+				if (h_chords[h][0] <= v_chords[v][2] && v_chords[v][2] <= h_chords[h][1] && v_chords[v][0] <= h_chords[h][2] && h_chords[h][2] <= v_chords[v][1]) {
+					adj[h].push_back(v);
+				}
+			}
+		}
+
+		// maximum matching
+		std::vector<int> h_match(h_chords.size(), -1);
+		std::vector<int> v_match(v_chords.size(), -1);
+		for (int h = 0; h < h_chords.size(); h++) {
+			std::vector<bool> visited(v_chords.size(), false);
+			findAugmentingPath(h, adj, h_match, v_match, visited);
+		}
+
+		// the vertices reachable from the unmatched horizontal chords by the alternating paths give the minimum vertex cover
+		// (König's theorem), and the rest of the chords are the maximum independent set
+		std::vector<bool> h_reached(h_chords.size(), false);
+		std::vector<bool> v_reached(v_chords.size(), false);
+		std::vector<int> queue;
+		for (int h = 0; h < h_chords.size(); h++) {
+			if (h_match[h] == -1) {
+				h_reached[h] = true;
+				queue.push_back(h);
+			}
+		}
+		for (int q = 0; q < queue.size(); q++) {
+			for (int v : adj[queue[q]]) {
+				if (v_reached[v]) continue;
+				v_reached[v] = true;
+				if (v_match[v] >= 0 && !h_reached[v_match[v]]) {
+					h_reached[v_match[v]] = true;
+					queue.push_back(v_match[v]);
+				}
+			}
+		}
+
+		// draw the selected chords
+		std::vector<std::vector<bool>> h_cuts(rows + 1, std::vector<bool>(cols, false));
+		std::vector<std::vector<bool>> v_cuts(cols + 1, std::vector<bool>(rows, false));
+		for (int h = 0; h < h_chords.size(); h++) {
+			if (!h_reached[h]) continue;
+			for (int i = h_chords[h][0]; i < h_chords[h][1]; i++) {
+				h_cuts[h_chords[h][2]][i] = true;
+			}
+		}
+		for (int v = 0; v < v_chords.size(); v++) {
+			if (v_reached[v]) continue;
+			for (int j = v_chords[v][0]; j < v_chords[v][1]; j++) {
+				v_cuts[v_chords[v][2]][j] = true;
+			}
+		}
+
+		// draw a segment from each concave vertex that is not resolved yet until it hits the boundary or another segment
+		for (int k = 0; k < concave_vertices.size(); k++) {
+			int i = concave_vertices[k].x;
+			int j = concave_vertices[k].y;
+			int dx = directions[k].x;
+			int dy = directions[k].y;
+			if (h_cuts[j][dx > 0 ? i : i - 1] || v_cuts[i][dy > 0 ? j : j - 1]) continue;
+
+			while (true) {
+				int e = dx > 0 ? i : i - 1;
+				if (!interiorH(e, j) || h_cuts[j][e]) break;
+				h_cuts[j][e] = true;
+				i += dx;
+				if (v_cuts[i][j - 1] || v_cuts[i][j]) break;
+			}
+		}
+
+		// collect the pieces, each of which should be a rectangle
+		std::vector<std::vector<bool>> visited(rows, std::vector<bool>(cols, false));
+		std::vector<cv::Point> stack;
+		for (int r = 0; r < rows; r++) {
+			for (int c = 0; c < cols; c++) {
+				if (!grid[r][c] || visited[r][c]) continue;
+
+				int min_x = c;
+				int max_x = c;
+				int min_y = r;
+				int max_y = r;
+				int num_cells = 0;
+				visited[r][c] = true;
+				stack.push_back(cv::Point(c, r));
+				while (!stack.empty()) {
+					cv::Point p = stack.back();
+					stack.pop_back();
+					num_cells++;
+					min_x = std::min(min_x, p.x);
+					max_x = std::max(max_x, p.x);
+					min_y = std::min(min_y, p.y);
+					max_y = std::max(max_y, p.y);
+
+					if (interiorV(p.x, p.y) && !v_cuts[p.x][p.y] && !visited[p.y][p.x - 1]) {
+						visited[p.y][p.x - 1] = true;
+						stack.push_back(cv::Point(p.x - 1, p.y));
+					}
+					if (interiorV(p.x + 1, p.y) && !v_cuts[p.x + 1][p.y] && !visited[p.y][p.x + 1]) {
+						visited[p.y][p.x + 1] = true;
+						stack.push_back(cv::Point(p.x + 1, p.y));
+					}
+					if (interiorH(p.x, p.y) && !h_cuts[p.y][p.x] && !visited[p.y - 1][p.x]) {
+						visited[p.y - 1][p.x] = true;
+						stack.push_back(cv::Point(p.x, p.y - 1));
+					}
+					if (interiorH(p.x, p.y + 1) && !h_cuts[p.y + 1][p.x] && !visited[p.y + 1][p.x]) {
+						visited[p.y + 1][p.x] = true;
+						stack.push_back(cv::Point(p.x, p.y + 1));
 					}
 				}
+
+				if (num_cells != (max_x - min_x + 1) * (max_y - min_y + 1)) return false;
+				rectangles.push_back(cv::Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1));
 			}
 		}
+
+		return true;
 	}
 
+	/**
+	 * Find an augmenting path from the horizontal chord h in the bipartite graph of the intersecting chords.
+	 */
+	bool RightAngleSimplification::findAugmentingPath(int h, const std::vector<std::vector<int>>& adj, std::vector<int>& h_match, std::vector<int>& v_match, std::vector<bool>& visited) {
+		for (int v : adj[h]) {
+			if (visited[v]) continue;
+			visited[v] = true;
+			if (v_match[v] == -1 || findAugmentingPath(v_match[v], adj, h_match, v_match, visited)) {
+				h_match[h] = v;
+				v_match[v] = h;
+				return true;
+			}
+		}
+		return false;
+	}
 }
@@ -4,29 +4,40 @@
 #include <opencv2/opencv.hpp>
 #include "../util/BuildingLayer.h"
 #include "../util/ContourUtils.h"
+#include "../util/ThreadPool.h"
 
 namespace simp {
 
 	class RightAngleSimplification {
+	protected:
+		static const int NUM_REFINED_OFFSETS = 3;
+
 	protected:
 		RightAngleSimplification() {}
 
 	public:
-		static util::Polygon simplify(const util::Polygon& polygon, int resolution, float orientation, float min_hole_ratio, bool optimization);
-		static void decomposePolygon(util::Polygon& polygon);
+		static util::Polygon simplify(const util::Polygon& polygon, int resolution, float orientation, float min_hole_ratio, bool optimization, bool coarse_to_fine = false, bool diagonal = false, bool minimum_partition = false, util::ThreadPool* pool = NULL);
+		static bool decomposePolygon(util::Polygon& polygon, bool minimum_partition = false);
+
+		// the refinement steps, which LEGO_Test checks against rasterization
+		static double optimizeVertices(const std::vector<cv::Point>& contour, std::vector<cv::Point>& simplified_contour);
+		static std::vector<cv::Point> proposedContour(const std::vector<cv::Point>& contour, std::map<int, int>& x_map, std::map<int, int>& y_map);
+		static std::vector<cv::Point> proposedBBox(const std::vector<cv::Point>& contour, int x1, int x2, int y1, int y2, int new_x1, int new_x2, int new_y1, int new_y2);
 
 	private:
-		static std::tuple<float, int, int> simplifyContour(const util::Ring& contour, util::Ring& result, int resolution, float orientation, bool optimization);
+		static std::tuple<float, int, int> simplifyContour(const util::Ring& contour, util::Ring& result, int resolution, float orientation, bool optimization, bool coarse_to_fine, bool diagonal, util::ThreadPool* pool);
+		static std::vector<cv::Point2d> rotateContour(const std::vector<cv::Point2f>& contour, float theta);
 		static double simplifyContour(const util::Ring& contour, util::Ring& result, int resolution, float angle, int dx, int dy, bool refine, bool vertex_refinement);
+		static double simplifyRotatedContour(const std::vector<cv::Point2d>& rotated_contour, util::Ring& result, int resolution, float angle, int dx, int dy, bool refine, bool vertex_refinement);
 
-		static double optimizeVertices(const std::vector<cv::Point>& contour, std::vector<cv::Point>& simplified_contour);
-		static std::vector<cv::Point> proposedContour(const std::vector<cv::Point>& contour, std::map<int, int>& x_map, std::map<int, int>& y_map);
 		static double optimizeBBox(const std::vector<cv::Point>& contour, std::vector<cv::Point>& simplified_contour);
-		static std::vector<cv::Point> proposedBBox(const std::vector<cv::Point>& contour, int x1, int x2, int y1, int y2, int new_x1, int new_x2, int new_y1, int new_y2);
 
 		static std::vector<util::Polygon> findContours(const cv::Mat_<uchar>& img);
 		static void refineContour(util::Ring& polygon);
+		static bool classifyCells(const util::Ring& ring, const std::vector<float>& x_coords, const std::vector<float>& y_coords, std::vector<std::vector<bool>>& inside);
 		static void findMaximumRectangle(const std::vector<std::vector<bool>>& grid, const std::vector<float>& x_coords, const std::vector<float>& y_coords, int& x, int& y, int& width, int& height);
+		static bool findMinimumPartition(const std::vector<std::vector<bool>>& grid, std::vector<cv::Rect>& rectangles);
+		static bool findAugmentingPath(int h, const std::vector<std::vector<int>>& adj, std::vector<int>& h_match, std::vector<int>& v_match, std::vector<bool>& visited);
 	};
 
 }
\ No newline at end of file
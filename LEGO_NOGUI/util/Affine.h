@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+namespace util {
+
+	/**
+	 * 2D affine transformation, i.e., the 3x3 matrix [m00 m01 m02; m10 m11 m12; 0 0 1], held by value.
+	 * Copying it does not allocate, so the rings and the polygons that carry one are cheap to copy.
+	 * The products are accumulated in double and rounded to float at the end.
+	 */
+	class Affine {
+	public:
+		float m00, m01, m02;
+		float m10, m11, m12;
+
+	public:
+		Affine() : m00(1), m01(0), m02(0), m10(0), m11(1), m12(0) {}
+		Affine(float m00, float m01, float m02, float m10, float m11, float m12) : m00(m00), m01(m01), m02(m02), m10(m10), m11(m11), m12(m12) {}
+
+		static Affine translation(float x, float y) { return Affine(1, 0, x, 0, 1, y); }
+		static Affine rotation(double theta) { return Affine(std::cos(theta), -std::sin(theta), 0, std::sin(theta), std::cos(theta), 0); }
+
+		bool isIdentity() const { return m00 == 1 && m01 == 0 && m02 == 0 && m10 == 0 && m11 == 1 && m12 == 0; }
+
+		/**
+		 * Return the transformation that applies m first and then this.
+		 */
+		Affine operator*(const Affine& m) const {
+			return Affine((float)((double)m00 * m.m00 + (double)m01 * m.m10), (float)((double)m00 * m.m01 + (double)m01 * m.m11), (float)((double)m00 * m.m02 + (double)m01 * m.m12 + m02),
+				(float)((double)m10 * m.m00 + (double)m11 * m.m10), (float)((double)m10 * m.m01 + (double)m11 * m.m11), (float)((double)m10 * m.m02 + (double)m11 * m.m12 + m12));
+		}
+
+		cv::Point2f operator*(const cv::Point2f& pt) const {
+			return cv::Point2f((float)((double)m00 * pt.x + (double)m01 * pt.y + m02), (float)((double)m10 * pt.x + (double)m11 * pt.y + m12));
+		}
+
+		Affine inv() const {
+			double det = (double)m00 * m11 - (double)m01 * m10;
+			if (det == 0) return Affine(0, 0, 0, 0, 0, 0);
+			double a = m11 / det;
+			double b = -m01 / det;
+			double c = -m10 / det;
+			double d = m00 / det;
+			return Affine((float)a, (float)b, (float)(-a * m02 - b * m12), (float)c, (float)d, (float)(-c * m02 - d * m12));
+		}
+
+		/**
+		 * Transform n points from src to dst, which may be the same array.
+		 * The loop works on the interleaved coordinates without any branch so that the compiler can vectorize it.
+		 */
+		void transform(const cv::Point2f* src, cv::Point2f* dst, size_t n) const {
+			if (isIdentity()) {
+				if (src != dst) std::copy(src, src + n, dst);
+				return;
+			}
+
+			const float* s = &src->x;
+			float* d = &dst->x;
+			const double a00 = m00, a01 = m01, a02 = m02, a10 = m10, a11 = m11, a12 = m12;
+			for (size_t i = 0; i < n; i++) {
+				double x = s[i * 2];
+				double y = s[i * 2 + 1];
+				d[i * 2] = (float)(a00 * x + a01 * y + a02);
+				d[i * 2 + 1] = (float)(a10 * x + a11 * y + a12);
+			}
+		}
+
+		std::vector<cv::Point2f> transform(const std::vector<cv::Point2f>& points) const {
+			std::vector<cv::Point2f> ans(points.size());
+			if (points.size() > 0) transform(points.data(), ans.data(), points.size());
+			return ans;
+		}
+	};
+
+}
@@ -0,0 +1,120 @@
+#include "BinaryVolume.h"
+
+namespace util {
+
+	BinaryVolume::BinaryVolume() : width(0), height(0), depth(0), words_per_row(0) {
+	}
+
+	/**
+	 * Create an empty volume of the specified size.
+	 */
+	BinaryVolume::BinaryVolume(int width, int height, int depth) : width(width), height(height), depth(depth) {
+		words_per_row = (width + 63) / 64;
+		size_t num_words = (size_t)words_per_row * height * depth;
+		words = std::shared_ptr<uint64_t>(new uint64_t[std::max((size_t)1, num_words)](), std::default_delete<uint64_t[]>());
+	}
+
+	/**
+	 * Create a volume which uses the given bits without copying them.
+	 * The bits have to be laid out as described in the class comment, e.g., a memory-mapped file.
+	 */
+	BinaryVolume::BinaryVolume(int width, int height, int depth, const std::shared_ptr<uint64_t>& words) : width(width), height(height), depth(depth), words(words) {
+		words_per_row = (width + 63) / 64;
+	}
+
+	/**
+	 * Create a volume from the slice images.
+	 * A voxel is occupied if its value is greater than the threshold.
+	 */
+	BinaryVolume::BinaryVolume(const std::vector<cv::Mat_<uchar>>& voxel_data, int voxel_value_threshold) : BinaryVolume(voxel_data.size() > 0 ? voxel_data[0].cols : 0, voxel_data.size() > 0 ? voxel_data[0].rows : 0, voxel_data.size()) {
+		for (int z = 0; z < depth; z++) {
+			setSlice(z, voxel_data[z], voxel_value_threshold);
+		}
+	}
+
+	/**
+	 * Set the occupancy of the z-th slice from the image.
+	 * Different slices can be set from different threads at the same time.
+	 *
+	 * @param z						slice index
+	 * @param slice					slice image of the size width x height
+	 * @param voxel_value_threshold	a voxel is occupied if its value is greater than this threshold
+	 */
+	void BinaryVolume::setSlice(int z, const cv::Mat_<uchar>& slice, int voxel_value_threshold) {
+		if (slice.cols != width || slice.rows != height) throw "The slice size does not match the volume size.";
+
+		// threshold the whole slice at once so that OpenCV can use SIMD, and then pack each bit
+		cv::Mat_<uchar> mask;
+		cv::compare(slice, voxel_value_threshold, mask, cv::CMP_GT);
+
+		for (int y = 0; y < height; y++) {
+			const uchar* src = mask.ptr<uchar>(y);
+			uint64_t* dst = row(y, z);
+			for (int w = 0; w < words_per_row; w++) {
+				int n = std::min(64, width - w * 64);
+				const uchar* p = src + w * 64;
+				uint64_t word = 0;
+				for (int i = 0; i < n; i++) {
+					word |= (uint64_t)(p[i] & 1) << i;
+				}
+				dst[w] = word;
+			}
+		}
+	}
+
+	/**
+	 * Set the occupancy of the z-th slice from the image, where only the voxels in roi can be occupied.
+	 * The pixels of the image outside roi are not read, e.g., the pages of a memory-mapped slice outside its bounding box.
+	 *
+	 * @param z						slice index
+	 * @param slice					slice image of the size width x height
+	 * @param voxel_value_threshold	a voxel is occupied if its value is greater than this threshold
+	 * @param roi					the region that contains all the occupied voxels of the slice
+	 */
+	void BinaryVolume::setSlice(int z, const cv::Mat_<uchar>& slice, int voxel_value_threshold, const cv::Rect& roi) {
+		if (slice.cols != width || slice.rows != height) throw "The slice size does not match the volume size.";
+
+		cv::Rect rect = roi & cv::Rect(0, 0, width, height);
+		cv::Mat_<uchar> mask;
+		if (rect.area() > 0) cv::compare(slice(rect), voxel_value_threshold, mask, cv::CMP_GT);
+
+		for (int y = 0; y < height; y++) {
+			uint64_t* dst = row(y, z);
+			std::fill(dst, dst + words_per_row, 0);
+			if (y < rect.y || y >= rect.y + rect.height) continue;
+
+			const uchar* src = mask.ptr<uchar>(y - rect.y);
+			for (int x = rect.x; x < rect.x + rect.width; x++) {
+				dst[x >> 6] |= (uint64_t)(src[x - rect.x] & 1) << (x & 63);
+			}
+		}
+	}
+
+	/**
+	 * Return the z-th slice as an image whose occupied voxels are 255.
+	 */
+	cv::Mat_<uchar> BinaryVolume::slice(int z) const {
+		cv::Mat_<uchar> ans(height, width);
+		for (int y = 0; y < height; y++) {
+			const uint64_t* src = row(y, z);
+			uchar* dst = ans.ptr<uchar>(y);
+			for (int x = 0; x < width; x++) {
+				dst[x] = ((src[x >> 6] >> (x & 63)) & 1) ? 255 : 0;
+			}
+		}
+		return ans;
+	}
+
+	/**
+	 * Return the number of occupied voxels in the z-th slice.
+	 */
+	long long BinaryVolume::count(int z) const {
+		long long ans = 0;
+		const uint64_t* p = row(0, z);
+		for (size_t i = 0; i < (size_t)height * words_per_row; i++) {
+			ans += popcount(p[i]);
+		}
+		return ans;
+	}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace util {
+
+	/**
+	 * Return the number of set bits in the word.
+	 */
+	inline int popcount(uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+		return (int)__popcnt64(word);
+#elif defined(__GNUC__)
+		return __builtin_popcountll(word);
+#else
+		int ans = 0;
+		for (; word; word &= word - 1) ans++;
+		return ans;
+#endif
+	}
+
+	/**
+	 * Return the index of the lowest set bit of the word, which must not be zero.
+	 */
+	inline int countTrailingZeros(uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (int)index;
+#elif defined(__GNUC__)
+		return __builtin_ctzll(word);
+#else
+		int ans = 0;
+		for (; (word & 1) == 0; word >>= 1) ans++;
+		return ans;
+#endif
+	}
+
+	/**
+	 * Occupancy of a voxel volume packed in 1 bit per voxel.
+	 * Each row of a slice is stored in words_per_row 64-bit words, and bit (x % 64) of word (x / 64) represents column x.
+	 * The unused bits at the end of each row are always zero, so that a row can be processed word by word.
+	 * Copies share the same bits.
+	 */
+	class BinaryVolume {
+	public:
+		int width;
+		int height;
+		int depth;
+		int words_per_row;
+
+	private:
+		std::shared_ptr<uint64_t> words;
+
+	public:
+		BinaryVolume();
+		BinaryVolume(int width, int height, int depth);
+		BinaryVolume(int width, int height, int depth, const std::shared_ptr<uint64_t>& words);
+		explicit BinaryVolume(const std::vector<cv::Mat_<uchar>>& voxel_data, int voxel_value_threshold = 128);
+
+		bool empty() const { return depth == 0; }
+		cv::Size sliceSize() const { return cv::Size(width, height); }
+		bool get(int x, int y, int z) const { return (row(y, z)[x >> 6] >> (x & 63)) & 1; }
+		const uint64_t* row(int y, int z) const { return words.get() + ((size_t)z * height + y) * words_per_row; }
+		uint64_t* row(int y, int z) { return words.get() + ((size_t)z * height + y) * words_per_row; }
+		void setSlice(int z, const cv::Mat_<uchar>& slice, int voxel_value_threshold);
+		void setSlice(int z, const cv::Mat_<uchar>& slice, int voxel_value_threshold, const cv::Rect& roi);
+		cv::Mat_<uchar> slice(int z) const;
+		long long count(int z) const;
+	};
+
+}
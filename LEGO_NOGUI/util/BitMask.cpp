@@ -0,0 +1,102 @@
+#include "BitMask.h"
+
+namespace util {
+
+	BitMask::BitMask() : first_word(0), y(0), words_per_row(0), height(0), count(0) {
+	}
+
+	/**
+	 * Create an empty mask that covers the bounding box.
+	 */
+	BitMask::BitMask(const cv::Rect& bbox) : y(bbox.y), height(bbox.height), count(0) {
+		first_word = bbox.x >> 6;
+		words_per_row = ((bbox.x + bbox.width - 1) >> 6) - first_word + 1;
+		words.resize((size_t)words_per_row * height, 0);
+	}
+
+	/**
+	 * Create a mask of the non-zero pixels of the cropped slice image.
+	 *
+	 * @param roi_slice	slice image cropped to the bounding box of the region
+	 * @param x			x coordinate of the top left corner of the crop
+	 * @param y			y coordinate of the top left corner of the crop
+	 */
+	BitMask::BitMask(const cv::Mat_<uchar>& roi_slice, int x, int y) : BitMask(cv::Rect(x, y, roi_slice.cols, roi_slice.rows)) {
+		for (int r = 0; r < roi_slice.rows; r++) {
+			const uchar* row = roi_slice.ptr<uchar>(r);
+			for (int c = 0; c < roi_slice.cols;) {
+				if (row[c] == 0) {
+					c++;
+					continue;
+				}
+				int c2 = c + 1;
+				while (c2 < roi_slice.cols && row[c2] != 0) c2++;
+				setRun(y + r, x + c, x + c2);
+				c = c2;
+			}
+		}
+	}
+
+	/**
+	 * Set the bits of the run [x0, x1) in row y.
+	 * The coordinates are the ones of the whole slice, and the run must not overlap the bits that are already set.
+	 */
+	void BitMask::setRun(int y, int x0, int x1) {
+		uint64_t* row = words.data() + (size_t)(y - this->y) * words_per_row;
+		for (int w = x0 >> 6; w <= (x1 - 1) >> 6; w++) {
+			int b0 = std::max(x0 - w * 64, 0);
+			int b1 = std::min(x1 - w * 64, 64);
+			uint64_t bits = (b1 - b0 == 64) ? ~0ULL : (((1ULL << (b1 - b0)) - 1) << b0);
+			row[w - first_word] |= bits;
+		}
+		count += x1 - x0;
+	}
+
+	/**
+	 * Return the number of the bits set in both masks.
+	 * Only the rows and the word columns shared by the two masks are visited.
+	 */
+	int BitMask::intersectionCount(const BitMask& other) const {
+		int y0 = std::max(y, other.y);
+		int y1 = std::min(y + height, other.y + other.height);
+		int w0 = std::max(first_word, other.first_word);
+		int w1 = std::min(first_word + words_per_row, other.first_word + other.words_per_row);
+
+		int ans = 0;
+		for (int r = y0; r < y1; r++) {
+			const uint64_t* row = words.data() + (size_t)(r - y) * words_per_row;
+			const uint64_t* row2 = other.words.data() + (size_t)(r - other.y) * other.words_per_row;
+			for (int w = w0; w < w1; w++) {
+				ans += popcount(row[w - first_word] & row2[w - other.first_word]);
+			}
+		}
+		return ans;
+	}
+
+	/**
+	 * Calculate the intersection over union (IOU) between two sets of masks.
+	 * The masks in each set must not overlap each other, e.g., the connected components of a slice,
+	 * so that the union of each set is just the sum of the counts.
+	 */
+	double BitMask::calculateIOU(const std::vector<const BitMask*>& masks1, const std::vector<const BitMask*>& masks2) {
+		long long count1 = 0;
+		long long count2 = 0;
+		long long inter_cnt = 0;
+		for (auto mask1 : masks1) {
+			count1 += mask1->count;
+		}
+		for (auto mask2 : masks2) {
+			count2 += mask2->count;
+		}
+		for (auto mask1 : masks1) {
+			for (auto mask2 : masks2) {
+				inter_cnt += mask1->intersectionCount(*mask2);
+			}
+		}
+
+		long long union_cnt = count1 + count2 - inter_cnt;
+		if (union_cnt == 0) return 0;
+		return (double)inter_cnt / union_cnt;
+	}
+
+}
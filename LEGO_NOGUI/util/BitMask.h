@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "BinaryVolume.h"
+
+namespace util {
+
+	/**
+	 * Bit mask of a region in a slice, cropped to the rows and the 64-bit word columns that the region touches.
+	 * The words are aligned to the word columns of the whole slice, i.e., bit (x % 64) of word column (x / 64)
+	 * represents column x, so that two masks can be combined word by word without any shift.
+	 */
+	class BitMask {
+	public:
+		int first_word;		// the first word column in the slice
+		int y;				// the first row in the slice
+		int words_per_row;
+		int height;
+		int count;			// the number of the set bits
+		std::vector<uint64_t> words;
+
+	public:
+		BitMask();
+		BitMask(const cv::Rect& bbox);
+		BitMask(const cv::Mat_<uchar>& roi_slice, int x, int y);
+
+		bool empty() const { return words.size() == 0; }
+		void setRun(int y, int x0, int x1);
+		int intersectionCount(const BitMask& other) const;
+		static double calculateIOU(const std::vector<const BitMask*>& masks1, const std::vector<const BitMask*>& masks2);
+	};
+
+}
@@ -15,16 +15,27 @@ namespace util {
 		this->top_height = top_height;
 	}
 
-	std::vector<util::Polygon> BuildingLayer::selectRepresentativeContours() {
-		// calculate the bounding box
+	/**
+	 * Compute the representative contours of the layer from the raw footprints of its slices.
+	 * Each slice is rasterized at 2x resolution, and the pixels covered by more than about 1/3 of the slices are kept.
+	 * The coverage is counted in integers, and the slices are rasterized in parallel for large layers.
+	 *
+	 * @param pool	thread pool of the caller, which is shared with the other layers
+	 */
+	std::vector<util::Polygon> BuildingLayer::selectRepresentativeContours(ThreadPool& pool) {
+		// convert the footprints to the points in the 2x image, and calculate the bounding box
 		int min_x = INT_MAX;
 		int min_y = INT_MAX;
 		int max_x = INT_MIN;
 		int max_y = INT_MIN;
-		for (auto& polygons : raw_footprints) {
-			for (auto& polygon : polygons) {
-				Ring contour = polygon.contour.getActualPoints();
-				for (auto& pt : contour) {
+		std::vector<std::vector<std::vector<std::vector<cv::Point2f>>>> actual_footprints(raw_footprints.size());
+		for (int i = 0; i < raw_footprints.size(); i++) {
+			for (auto& polygon : raw_footprints[i].polygons) {
+				actual_footprints[i].push_back({ polygon->contour.getActualPoints().points });
+				for (auto& hole : polygon->holes) {
+					actual_footprints[i].back().push_back(hole.getActualPoints().points);
+				}
+				for (auto& pt : actual_footprints[i].back()[0]) {
 					min_x = std::min(min_x, (int)pt.x);
 					min_y = std::min(min_y, (int)pt.y);
 					max_x = std::max(max_x, (int)(pt.x + 0.5));
@@ -33,39 +44,57 @@ namespace util {
 			}
 		}
 
-		// calculate the average contour image
 		int width = max_x - min_x + 1;
 		int height = max_y - min_y + 1;
-		cv::Mat_<double> total_img = cv::Mat_<double>::zeros(height * 2, width * 2);
-		for (auto& polygons : raw_footprints) {
-			cv::Mat_<uchar> img = cv::Mat_<uchar>::zeros(height * 2, width * 2);
-			for (auto& polygon : polygons) {
-				std::vector<std::vector<cv::Point>> contour_points(1 + polygon.holes.size());
-				Ring contour = polygon.contour.getActualPoints();
-				contour_points[0].resize(contour.size());
-				for (int i = 0; i < contour.size(); i++) {
-					contour_points[0][i] = cv::Point((contour[i].x - min_x) * 2, (contour[i].y - min_y) * 2);
-				}
-				for (int i = 0; i < polygon.holes.size(); i++) {
-					Ring hole = polygon.holes[i].getActualPoints();
-					contour_points[i + 1].resize(hole.size());
-					for (int j = 0; j < hole.size(); j++) {
-						contour_points[i + 1][j] = cv::Point((hole[j].x - min_x) * 2, (hole[j].y - min_y) * 2);
+		std::vector<std::vector<std::vector<std::vector<cv::Point>>>> slice_points(raw_footprints.size());
+		for (int i = 0; i < raw_footprints.size(); i++) {
+			for (auto& rings : actual_footprints[i]) {
+				slice_points[i].push_back(std::vector<std::vector<cv::Point>>(rings.size()));
+				for (int j = 0; j < rings.size(); j++) {
+					slice_points[i].back()[j].resize(rings[j].size());
+					for (int k = 0; k < rings[j].size(); k++) {
+						slice_points[i].back()[j][k] = cv::Point((rings[j][k].x - min_x) * 2, (rings[j][k].y - min_y) * 2);
 					}
 				}
-				cv::fillPoly(img, contour_points, cv::Scalar(255), cv::LINE_4);
 			}
+		}
 
-			cv::Mat_<double> img_double;
-			img.convertTo(img_double, CV_64F);
-			total_img += img_double;
+		// Each footprint counts as many times as the number of the slices it represents.
+		// If all the slices have the same footprint, which is typical for the walls of a box,
+		// the average is the footprint itself.
+		std::vector<int> weights(raw_footprints.size());
+		int num_slices = 0;
+		for (int i = 0; i < raw_footprints.size(); i++) {
+			weights[i] = raw_footprints[i].num_slices;
+			num_slices += weights[i];
 		}
-		total_img /= raw_footprints.size();
-		cv::Mat_<uchar> mean_img;
-		total_img.convertTo(mean_img, CV_8U);
+		for (int i = 1; i < slice_points.size(); i++) {
+			if (slice_points[i] != slice_points[0]) break;
+			if (i == slice_points.size() - 1) {
+				slice_points.resize(1);
+				weights.assign(1, 1);
+				num_slices = 1;
+			}
+		}
+		if (num_slices > USHRT_MAX) throw "Too many slices in a layer.";
+
+		// count the slices that cover each pixel
+		cv::Mat_<ushort> vote_img = countCoverage(slice_points, weights, width * 2, height * 2, pool);
 
-		cv::Mat_<uchar> mean_img_thresholded;
-		cv::threshold(mean_img, mean_img_thresholded, 80, 255, cv::THRESH_BINARY);
+		// A pixel is kept if its average value exceeds 80 as in an 8-bit image.
+		// The average is computed in the same way as accumulating the images in double for the same result.
+		std::vector<uchar> lut(num_slices + 1);
+		for (int i = 0; i <= num_slices; i++) {
+			lut[i] = cv::saturate_cast<uchar>(255.0 * i * (1.0 / num_slices)) > 80 ? 255 : 0;
+		}
+		cv::Mat_<uchar> mean_img_thresholded(height * 2, width * 2);
+		for (int r = 0; r < vote_img.rows; r++) {
+			const ushort* vote_row = vote_img.ptr<ushort>(r);
+			uchar* row = mean_img_thresholded.ptr<uchar>(r);
+			for (int c = 0; c < vote_img.cols; c++) {
+				row[c] = lut[vote_row[c]];
+			}
+		}
 
 		// erode image
 		cv::Mat_<uchar> eroded_img;
@@ -85,6 +114,70 @@ namespace util {
 		return contours;
 	}
 
+	/**
+	 * Count the number of the slices that cover each pixel, where the i-th footprint counts weights[i] times.
+	 * Each footprint is filled into a scratch image, and only the rows and the columns spanned by its points
+	 * are added to the counts and cleared again, so nothing is allocated per footprint.
+	 * The footprints are split into chunks that have their own counts, which are summed up at the end.
+	 * The chunks run on the pool of the caller, so no thread is started here.
+	 */
+	cv::Mat_<ushort> BuildingLayer::countCoverage(const std::vector<std::vector<std::vector<std::vector<cv::Point>>>>& slice_points, const std::vector<int>& weights, int width, int height, ThreadPool& pool) {
+		// use a single chunk for a small layer, for which the extra counts cost more than the rasterization
+		int num_slices = slice_points.size();
+		long long num_pixels = (long long)num_slices * width * height;
+		int num_chunks = num_pixels >= (1 << 22) ? std::min(pool.size(), num_slices) : 1;
+
+		std::vector<cv::Mat_<ushort>> vote_imgs(num_chunks);
+		pool.parallelFor(num_chunks, [&](int chunk) {
+			cv::Mat_<uchar> img = cv::Mat_<uchar>::zeros(height, width);
+			vote_imgs[chunk] = cv::Mat_<ushort>::zeros(height, width);
+			for (int i = (long long)num_slices * chunk / num_chunks; i < (long long)num_slices * (chunk + 1) / num_chunks; i++) {
+				int x0 = width;
+				int y0 = height;
+				int x1 = -1;
+				int y1 = -1;
+				for (auto& rings : slice_points[i]) {
+					cv::fillPoly(img, rings, cv::Scalar(255), cv::LINE_4);
+					for (auto& pt : rings[0]) {
+						x0 = std::min(x0, pt.x);
+						y0 = std::min(y0, pt.y);
+						x1 = std::max(x1, pt.x);
+						y1 = std::max(y1, pt.y);
+					}
+				}
+				x0 = std::max(x0, 0);
+				y0 = std::max(y0, 0);
+				x1 = std::min(x1, width - 1);
+				y1 = std::min(y1, height - 1);
+
+				for (int r = y0; r <= y1; r++) {
+					uchar* row = img.ptr<uchar>(r);
+					ushort* vote_row = vote_imgs[chunk].ptr<ushort>(r);
+					for (int c = x0; c <= x1; c++) {
+						if (row[c] != 0) vote_row[c] += weights[i];
+					}
+					if (x1 >= x0) memset(row + x0, 0, x1 - x0 + 1);
+				}
+			}
+		});
+
+		for (int chunk = 1; chunk < num_chunks; chunk++) {
+			vote_imgs[0] += vote_imgs[chunk];
+		}
+		return vote_imgs[0];
+	}
+
+	/**
+	 * Return the number of the slices that the raw footprints represent.
+	 */
+	int BuildingLayer::numRawSlices() const {
+		int ans = 0;
+		for (auto& raw_footprint : raw_footprints) {
+			ans += raw_footprint.num_slices;
+		}
+		return ans;
+	}
+
 	int BuildingLayer::getTopHeight() {
 		int ans = top_height;
 		for (auto& child : children) {
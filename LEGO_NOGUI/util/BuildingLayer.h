@@ -4,13 +4,28 @@
 #include <memory>
 #include <opencv2/opencv.hpp>
 #include "ContourUtils.h"
+#include "ThreadPool.h"
 
 namespace util {
 
+	/**
+	 * Footprint of one or more consecutive slices that have the same shape.
+	 * The polygons are shared with the voxel nodes and the other layers, so they must not be modified.
+	 */
+	class RawFootprint {
+	public:
+		std::vector<std::shared_ptr<const util::Polygon>> polygons;
+		int num_slices;		// the number of the slices that this footprint represents
+
+	public:
+		RawFootprint() : num_slices(1) {}
+		RawFootprint(const std::vector<std::shared_ptr<const util::Polygon>>& polygons, int num_slices = 1) : polygons(polygons), num_slices(num_slices) {}
+	};
+
 	class BuildingLayer {
 	public:
 		int building_id;
-		std::vector<std::vector<util::Polygon>> raw_footprints;
+		std::vector<RawFootprint> raw_footprints;
 		std::vector<util::Polygon> footprints;
 		float bottom_height;
 		float top_height;
@@ -21,8 +36,12 @@ namespace util {
 		BuildingLayer(int building_id, float bottom_height, float top_height);
 		BuildingLayer(int building_id, const std::vector<util::Polygon>& footprints, float bottom_height, float top_height);
 
-		std::vector<util::Polygon> selectRepresentativeContours();
+		std::vector<util::Polygon> selectRepresentativeContours(ThreadPool& pool);
 		int getTopHeight();
+		int numRawSlices() const;
+
+	private:
+		static cv::Mat_<ushort> countCoverage(const std::vector<std::vector<std::vector<std::vector<cv::Point>>>>& slice_points, const std::vector<int>& weights, int width, int height, ThreadPool& pool);
 	};
 
 }
\ No newline at end of file
@@ -7,7 +7,7 @@
 
 namespace util {
 	
-	PrimitiveRectangle::PrimitiveRectangle(const cv::Mat_<float>& mat, const cv::Point2f& min_pt, const cv::Point2f& max_pt) {
+	PrimitiveRectangle::PrimitiveRectangle(const Affine& mat, const cv::Point2f& min_pt, const cv::Point2f& max_pt) {
 		this->mat = mat;
 		this->min_pt = min_pt;
 		this->max_pt = max_pt;
@@ -21,19 +21,10 @@ namespace util {
 	std::vector<cv::Point2f> PrimitiveRectangle::getActualPoints() const {
 		std::vector<cv::Point2f> ans(4);
 
-		cv::Mat_<float> p0 = (cv::Mat_<float>(3, 1) << min_pt.x, min_pt.y, 1);
-		cv::Mat_<float> q0 = mat * p0;
-		cv::Mat_<float> p1 = (cv::Mat_<float>(3, 1) << max_pt.x, min_pt.y, 1);
-		cv::Mat_<float> q1 = mat * p1;
-		cv::Mat_<float> p2 = (cv::Mat_<float>(3, 1) << max_pt.x, max_pt.y, 1);
-		cv::Mat_<float> q2 = mat * p2;
-		cv::Mat_<float> p3 = (cv::Mat_<float>(3, 1) << min_pt.x, max_pt.y, 1);
-		cv::Mat_<float> q3 = mat * p3;
-
-		ans[0] = cv::Point2f(q0(0, 0), q0(1, 0));
-		ans[1] = cv::Point2f(q1(0, 0), q1(1, 0));
-		ans[2] = cv::Point2f(q2(0, 0), q2(1, 0));
-		ans[3] = cv::Point2f(q3(0, 0), q3(1, 0));
+		ans[0] = mat * cv::Point2f(min_pt.x, min_pt.y);
+		ans[1] = mat * cv::Point2f(max_pt.x, min_pt.y);
+		ans[2] = mat * cv::Point2f(max_pt.x, max_pt.y);
+		ans[3] = mat * cv::Point2f(min_pt.x, max_pt.y);
 
 		return ans;
 	}
@@ -42,11 +33,11 @@ namespace util {
 		return TYPE_RECTANGLE;
 	}
 
-	PrimitiveTriangle::PrimitiveTriangle(const cv::Mat_<float>& mat) {
+	PrimitiveTriangle::PrimitiveTriangle(const Affine& mat) {
 		this->mat = mat;
 	}
 
-	PrimitiveTriangle::PrimitiveTriangle(const cv::Mat_<float>& mat, const std::vector<cv::Point2f>& points) {
+	PrimitiveTriangle::PrimitiveTriangle(const Affine& mat, const std::vector<cv::Point2f>& points) {
 		this->mat = mat;
 		this->points = points;
 	}
@@ -57,21 +48,14 @@ namespace util {
 	}
 
 	std::vector<cv::Point2f> PrimitiveTriangle::getActualPoints() const {
-		std::vector<cv::Point2f> ans(points.size());
-
-		for (int i = 0; i < points.size(); i++) {
-			cv::Mat_<float> p = (cv::Mat_<float>(3, 1) << points[i].x, points[i].y, 1);
-			cv::Mat_<float> q = mat * p;
-			ans[i] = cv::Point2f(q(0, 0), q(1, 0));
-		}
-		return ans;
+		return mat.transform(points);
 	}
 
 	int PrimitiveTriangle::type() const {
 		return TYPE_TRIANGLE;
 	}
 
-	PrimitiveCurve::PrimitiveCurve(const cv::Mat_<float>& mat, float theta_start, float theta_end, const cv::Point2f &center, float radius) {
+	PrimitiveCurve::PrimitiveCurve(const Affine& mat, float theta_start, float theta_end, const cv::Point2f &center, float radius) {
 		this->mat = mat;
 		this->theta_start = theta_start;
 		this->theta_end = theta_end;
@@ -97,18 +81,14 @@ namespace util {
 		for (int k = 0; k < num_points - 1; k++) {
 			double x = abs(this->radius) * cos(CV_PI * (this->theta_start + angle_between * k) / 180) + this->center.x;
 			double y = abs(this->radius) * sin(CV_PI * (this->theta_start + angle_between * k) / 180) + this->center.y;
-			cv::Mat_<float> p = (cv::Mat_<float>(3, 1) << x, y, 1);
-			cv::Mat_<float> q = mat * p;
-			ans[k] = cv::Point2f(q(0, 0), q(1, 0));
+			ans[k] = mat * cv::Point2f(x, y);
 		}
 
 		// for the last point
 		{
 			double x = abs(this->radius) * cos(CV_PI * (this->theta_end) / 180) + this->center.x;
 			double y = abs(this->radius) * sin(CV_PI * (this->theta_end) / 180) + this->center.y;
-			cv::Mat_<float> p = (cv::Mat_<float>(3, 1) << x, y, 1);
-			cv::Mat_<float> q = mat * p;
-			ans.back() = cv::Point2f(q(0, 0), q(1, 0));
+			ans.back() = mat * cv::Point2f(x, y);
 		}
 
 		return ans;
@@ -119,25 +99,12 @@ namespace util {
 	}
 
 	Ring::Ring() {
-		mat = cv::Mat_<float>::eye(3, 3);
-	}
-
-	Ring::Ring(const Ring& ring) {
-		this->mat = ring.mat.clone();
-		this->points = ring.points;
 	}
 
 	Ring::Ring(const std::vector<cv::Point2f>& points) {
-		mat = cv::Mat_<float>::eye(3, 3);
 		this->points = points;
 	}
 
-	Ring& Ring::operator=(const Ring& ring) {
-		this->mat = ring.mat.clone();
-		this->points = ring.points;
-		return *this;
-	}
-
 	Ring& Ring::operator=(const std::vector<cv::Point2f>& points) {
 		this->points = points;
 		return *this;
@@ -206,13 +173,11 @@ namespace util {
 		}
 	}
 
-	void Ring::transform(const cv::Mat_<float>& m) {
+	void Ring::transform(const Affine& m) {
 		mat = m * mat;
 		/*
 		for (int i = 0; i < points.size(); i++) {
-			cv::Mat_<float> p = m * (cv::Mat_<float>(3, 1) << points[i].x, points[i].y, 1);
-			points[i].x = p(0, 0);
-			points[i].y = p(1, 0);
+			points[i] = m * points[i];
 		}
 		*/
 	}
@@ -230,26 +195,27 @@ namespace util {
 	}
 
 	cv::Point2f Ring::getActualPoint(int index) const {
-		cv::Mat_<float> pt = (cv::Mat_<float>(3, 1) << points[index].x, points[index].y, 1);
-		cv::Mat_<float> pt2 = mat * pt;
-
-		cv::Point2f ans;
-		ans.x = pt2(0, 0);
-		ans.y = pt2(1, 0);
-		return ans;
+		return mat * points[index];
 	}
 
 	Ring Ring::getActualPoints() const {
 		Ring ans;
-		ans.points.resize(points.size());
-		for (int i = 0; i < points.size(); i++) {
-			cv::Mat_<float> pt = (cv::Mat_<float>(3, 1) << points[i].x, points[i].y, 1);
-			cv::Mat_<float> pt2 = mat * pt;
-			ans.points[i].x = pt2(0, 0);
-			ans.points[i].y = pt2(1, 0);
-		}
+		ans.points = mat.transform(points);
 		return ans;
 	}
+
+	/**
+	 * Return the actual points of the ring without making a copy if possible.
+	 * The points are returned as they are if the ring is not transformed, and otherwise
+	 * they are transformed into the buffer, so the result is valid until the ring or the buffer is modified.
+	 */
+	const std::vector<cv::Point2f>& Ring::actualPoints(std::vector<cv::Point2f>& buffer) const {
+		if (mat.isIdentity()) return points;
+
+		buffer.resize(points.size());
+		if (points.size() > 0) mat.transform(points.data(), buffer.data(), points.size());
+		return buffer;
+	}
 	
 	bool Ring::isSimple() const {
 		CDT cdt;
@@ -261,7 +227,6 @@ namespace util {
 	}
 
 	Polygon::Polygon() {
-		mat = cv::Mat_<float>::eye(3, 3);
 	}
 
 	Polygon Polygon::clone() const {
@@ -285,7 +250,7 @@ namespace util {
 		}
 	}
 
-	void Polygon::transform(const cv::Mat_<float>& m) {
+	void Polygon::transform(const Affine& m) {
 		contour.transform(m);
 		for (int i = 0; i < holes.size(); i++) {
 			holes[i].transform(m);
@@ -330,8 +295,16 @@ namespace util {
 	bool isSimple(const Polygon& polygon) {
 		if (polygon.contour.size() == 0) return false;
 
+		// transform the rings only once
+		std::vector<cv::Point2f> contour_buffer;
+		const std::vector<cv::Point2f>& contour = polygon.contour.actualPoints(contour_buffer);
+		std::vector<std::vector<cv::Point2f>> hole_buffers(polygon.holes.size());
+		std::vector<const std::vector<cv::Point2f>*> holes(polygon.holes.size());
+		for (int i = 0; i < polygon.holes.size(); i++) {
+			holes[i] = &polygon.holes[i].actualPoints(hole_buffers[i]);
+		}
+
 		CGAL::Polygon_2<Kernel> pgn;
-		std::vector<cv::Point2f> contour = polygon.contour.getActualPoints().points;
 		for (int i = 0; i < contour.size(); i++) {
 			pgn.push_back(Kernel::Point_2(contour[i].x, contour[i].y));
 		}
@@ -341,7 +314,7 @@ namespace util {
 			if (polygon.holes[i].size() == 0) continue;
 
 			CGAL::Polygon_2<Kernel> hl;
-			std::vector<cv::Point2f> hole = polygon.holes[i].getActualPoints().points;
+			const std::vector<cv::Point2f>& hole = *holes[i];
 			for (int j = 0; j < hole.size(); j++) {
 				hl.push_back(Kernel::Point_2(hole[j].x, hole[j].y));
 			}
@@ -352,7 +325,7 @@ namespace util {
 			int i2 = (i + 1) % contour.size();
 
 			for (int j = 0; j < polygon.holes.size(); j++) {
-				std::vector<cv::Point2f> hole = polygon.holes[j].getActualPoints().points;
+				const std::vector<cv::Point2f>& hole = *holes[j];
 
 				for (int k = 0; k < hole.size(); k++) {
 					int k2 = (k + 1) % hole.size();
@@ -365,10 +338,10 @@ namespace util {
 			}
 		}
 		for (int i = 0; i < polygon.holes.size(); i++) {
-			std::vector<cv::Point2f> hole = polygon.holes[i].getActualPoints().points;
+			const std::vector<cv::Point2f>& hole = *holes[i];
 
 			for (int j = i + 1; j < polygon.holes.size(); j++) {
-				std::vector<cv::Point2f> hole2 = polygon.holes[j].getActualPoints().points;
+				const std::vector<cv::Point2f>& hole2 = *holes[j];
 
 				for (int k = 0; k < hole.size(); k++) {
 					int k2 = (k + 1) % hole.size();
@@ -405,12 +378,8 @@ namespace util {
 		return polygon.is_simple();
 	}
 
-	void transform(std::vector<cv::Point2f>& polygon, const cv::Mat_<float>& m) {
-		for (int i = 0; i < polygon.size(); i++) {
-			cv::Mat_<float> p = m * (cv::Mat_<float>(3, 1) << polygon[i].x, polygon[i].y, 1);
-			polygon[i].x = p(0, 0);
-			polygon[i].y = p(1, 0);
-		}
+	void transform(std::vector<cv::Point2f>& polygon, const Affine& m) {
+		if (polygon.size() > 0) m.transform(polygon.data(), polygon.data(), polygon.size());
 	}
 
 	/**
@@ -530,9 +499,9 @@ namespace util {
 		return cv::Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
 	}
 
-	cv::Rect calculateOBB(const std::vector<cv::Point2f>& polygon, cv::Mat_<float>& trans_mat) {
+	cv::Rect calculateOBB(const std::vector<cv::Point2f>& polygon, Affine& trans_mat) {
 		cv::Rect ans(0, 0, 0, 0);
-		trans_mat = (cv::Mat_<float>(2, 2) << 1, 0, 0, 1);
+		trans_mat = Affine();
 		int min_area = std::numeric_limits<int>::max();
 
 		for (int i = 0; i < polygon.size(); i++) {
@@ -541,15 +510,10 @@ namespace util {
 
 			// calculate the angle of the edge
 			float theta = std::atan2(polygon[next].y - polygon[i].y, polygon[next].x - polygon[i].x);
-			cv::Mat_<float> mat = (cv::Mat_<float>(2, 2) << std::cos(theta), std::sin(theta), -std::sin(theta), std::cos(theta));
+			Affine mat(std::cos(theta), std::sin(theta), 0, -std::sin(theta), std::cos(theta), 0);
 			
 			// rotate the polygon
-			std::vector<cv::Point2f> rotated_polygon(polygon.size());
-			for (int j = 0; j < polygon.size(); j++) {
-				cv::Mat_<float> p = (cv::Mat_<float>(2, 1) << polygon[j].x, polygon[j].y);
-				cv::Mat_<float> p2 = mat * p;
-				rotated_polygon[j] = cv::Point2f(p2(0, 0), p2(1, 0));
-			}
+			std::vector<cv::Point2f> rotated_polygon = mat.transform(polygon);
 
 			// calculate the bounding box
 			cv::Rect rect = boundingBox(rotated_polygon);
@@ -641,8 +605,10 @@ namespace util {
 	 * we resort to an image-based approach that can quickly calculate the approximate IOU.
 	 */
 	double calculateIOU(const Polygon& polygon1, const Polygon& polygon2) {
-		Ring contour1 = polygon1.contour.getActualPoints();
-		Ring contour2 = polygon2.contour.getActualPoints();
+		std::vector<cv::Point2f> contour_buffer1;
+		std::vector<cv::Point2f> contour_buffer2;
+		const std::vector<cv::Point2f>& contour1 = polygon1.contour.actualPoints(contour_buffer1);
+		const std::vector<cv::Point2f>& contour2 = polygon2.contour.actualPoints(contour_buffer2);
 
 		int min_x = INT_MAX;
 		int min_y = INT_MAX;
@@ -668,8 +634,9 @@ namespace util {
 		for (int i = 0; i < contour1.size(); i++) {
 			contour_points1[0][i] = cv::Point(contour1[i].x - min_x, contour1[i].y - min_y);
 		}
+		std::vector<cv::Point2f> hole_buffer;
 		for (int i = 0; i < polygon1.holes.size(); i++) {
-			Ring hole = polygon1.holes[i].getActualPoints();
+			const std::vector<cv::Point2f>& hole = polygon1.holes[i].actualPoints(hole_buffer);
 			contour_points1[i + 1].resize(hole.size());
 			for (int j = 0; j < hole.size(); j++) {
 				contour_points1[i + 1][j] = cv::Point(hole[j].x - min_x, hole[j].y - min_y);
@@ -685,7 +652,7 @@ namespace util {
 			contour_points2[0][i] = cv::Point(contour2[i].x - min_x, contour2[i].y - min_y);
 		}
 		for (int i = 0; i < polygon2.holes.size(); i++) {
-			Ring hole = polygon2.holes[i].getActualPoints();
+			const std::vector<cv::Point2f>& hole = polygon2.holes[i].actualPoints(hole_buffer);
 			contour_points2[i + 1].resize(hole.size());
 			for (int j = 0; j < hole.size(); j++) {
 				contour_points2[i + 1][j] = cv::Point(hole[j].x - min_x, hole[j].y - min_y);
@@ -758,18 +725,29 @@ namespace util {
 		int min_y = INT_MAX;
 		int max_x = INT_MIN;
 		int max_y = INT_MIN;
-		for (auto& polygon : polygons1) {
-			Ring contour1 = polygon.contour.getActualPoints();
-			for (auto& pt : contour1) {
+
+		// transform the contours only once
+		std::vector<std::vector<cv::Point2f>> contour_buffers1(polygons1.size());
+		std::vector<const std::vector<cv::Point2f>*> contours1(polygons1.size());
+		for (int i = 0; i < polygons1.size(); i++) {
+			contours1[i] = &polygons1[i].contour.actualPoints(contour_buffers1[i]);
+		}
+		std::vector<std::vector<cv::Point2f>> contour_buffers2(polygons2.size());
+		std::vector<const std::vector<cv::Point2f>*> contours2(polygons2.size());
+		for (int i = 0; i < polygons2.size(); i++) {
+			contours2[i] = &polygons2[i].contour.actualPoints(contour_buffers2[i]);
+		}
+
+		for (auto contour1 : contours1) {
+			for (auto& pt : *contour1) {
 				min_x = std::min(min_x, (int)pt.x);
 				min_y = std::min(min_y, (int)pt.y);
 				max_x = std::max(max_x, (int)(pt.x + 0.5));
 				max_y = std::max(max_y, (int)(pt.y + 0.5));
 			}
 		}
-		for (auto& polygon : polygons2) {
-			Ring contour2 = polygon.contour.getActualPoints();
-			for (auto& pt : contour2) {
+		for (auto contour2 : contours2) {
+			for (auto& pt : *contour2) {
 				min_x = std::min(min_x, (int)pt.x);
 				min_y = std::min(min_y, (int)pt.y);
 				max_x = std::max(max_x, (int)(pt.x + 0.5));
@@ -778,15 +756,17 @@ namespace util {
 		}
 
 		cv::Mat_<uchar> img1 = cv::Mat_<uchar>::zeros(max_y - min_y + 1, max_x - min_x + 1);
-		for (auto& polygon : polygons1) {
+		for (int pi = 0; pi < polygons1.size(); pi++) {
+			const Polygon& polygon = polygons1[pi];
 			std::vector<std::vector<cv::Point>> contour_points(1 + polygon.holes.size());
-			Ring contour = polygon.contour.getActualPoints();
+			const std::vector<cv::Point2f>& contour = *contours1[pi];
 			contour_points[0].resize(contour.size());
 			for (int i = 0; i < contour.size(); i++) {
 				contour_points[0][i] = cv::Point(contour[i].x - min_x, contour[i].y - min_y);
 			}
+			std::vector<cv::Point2f> hole_buffer;
 			for (int i = 0; i < polygon.holes.size(); i++) {
-				Ring hole = polygon.holes[i].getActualPoints();
+				const std::vector<cv::Point2f>& hole = polygon.holes[i].actualPoints(hole_buffer);
 				contour_points[i + 1].resize(hole.size());
 				for (int j = 0; j < hole.size(); j++) {
 					contour_points[i + 1][j] = cv::Point(hole[j].x - min_x, hole[j].y - min_y);
@@ -796,15 +776,17 @@ namespace util {
 		}
 
 		cv::Mat_<uchar> img2 = cv::Mat_<uchar>::zeros(max_y - min_y + 1, max_x - min_x + 1);
-		for (auto& polygon : polygons2) {
+		for (int pi = 0; pi < polygons2.size(); pi++) {
+			const Polygon& polygon = polygons2[pi];
 			std::vector<std::vector<cv::Point>> contour_points(1 + polygon.holes.size());
-			Ring contour = polygon.contour.getActualPoints();
+			const std::vector<cv::Point2f>& contour = *contours2[pi];
 			contour_points[0].resize(contour.size());
 			for (int i = 0; i < contour.size(); i++) {
 				contour_points[0][i] = cv::Point(contour[i].x - min_x, contour[i].y - min_y);
 			}
+			std::vector<cv::Point2f> hole_buffer;
 			for (int i = 0; i < polygon.holes.size(); i++) {
-				Ring hole = polygon.holes[i].getActualPoints();
+				const std::vector<cv::Point2f>& hole = polygon.holes[i].actualPoints(hole_buffer);
 				contour_points[i + 1].resize(hole.size());
 				for (int j = 0; j < hole.size(); j++) {
 					contour_points[i + 1][j] = cv::Point(hole[j].x - min_x, hole[j].y - min_y);
@@ -1087,13 +1069,14 @@ namespace util {
 		std::vector<std::vector<cv::Point>> contour_points(1 + polygon.holes.size());
 
 		contour_points[0].resize(polygon.contour.size());
-		Ring ring = polygon.contour.getActualPoints();
+		std::vector<cv::Point2f> buffer;
+		const std::vector<cv::Point2f>& ring = polygon.contour.actualPoints(buffer);
 		for (int i = 0; i < ring.size(); i++) {
 			contour_points[0][i] = cv::Point((ring[i].x + offset.x) * 2, (ring[i].y + offset.y) * 2);
 		}
 		for (int i = 0; i < polygon.holes.size(); i++) {
 			contour_points[i + 1].resize(polygon.holes[i].size());
-			Ring hole = polygon.holes[i].getActualPoints();
+			const std::vector<cv::Point2f>& hole = polygon.holes[i].actualPoints(buffer);
 			for (int j = 0; j < hole.size(); j++) {
 				contour_points[i + 1][j] = cv::Point((hole[j].x + offset.x) * 2, (hole[j].y + offset.y) * 2);
 			}
@@ -1255,17 +1238,34 @@ namespace util {
 	}
 	*/
 
+	/**
+	 * Return the actual points of the contour and the holes of each polygon in this order.
+	 */
+	std::vector<std::vector<cv::Point2f>> getActualRings(const std::vector<util::Polygon>& polygons) {
+		std::vector<std::vector<cv::Point2f>> ans;
+		for (auto& polygon : polygons) {
+			ans.push_back(polygon.contour.getActualPoints().points);
+			for (auto& hole : polygon.holes) {
+				ans.push_back(hole.getActualPoints().points);
+			}
+		}
+		return ans;
+	}
+
 	void snapPolygon(const std::vector<util::Polygon>& ref_polygons, util::Polygon& polygon, float snapping_threshold) {
 		util::Polygon ans;
 
+		// transform the reference polygons only once for all the rings of the polygon
+		std::vector<std::vector<cv::Point2f>> ref_rings = getActualRings(ref_polygons);
+
 		std::vector<cv::Point2f> contour = polygon.contour.getActualPoints().points;
-		util::snapPolygon(ref_polygons, contour, snapping_threshold);
+		util::snapPolygonToRings(ref_rings, contour, snapping_threshold);
 		ans.contour.points = contour;
 		if (!isSimple(ans.contour)) return;
 		
 		for (int j = 0; j < polygon.holes.size(); j++) {
 			std::vector<cv::Point2f> hole = polygon.holes[j].getActualPoints().points;
-			util::snapPolygon(ref_polygons, hole, snapping_threshold);
+			util::snapPolygonToRings(ref_rings, hole, snapping_threshold);
 			ans.holes.push_back(hole);
 		}
 
@@ -1275,6 +1275,13 @@ namespace util {
 	}
 	
 	void snapPolygon(const std::vector<util::Polygon>& ref_polygons, std::vector<cv::Point2f>& polygon, float snapping_threshold) {
+		snapPolygonToRings(getActualRings(ref_polygons), polygon, snapping_threshold);
+	}
+
+	/**
+	 * Snap the polygon to the reference rings, which are the actual points of the contours and the holes of the reference polygons.
+	 */
+	void snapPolygonToRings(const std::vector<std::vector<cv::Point2f>>& ref_rings, std::vector<cv::Point2f>& polygon, float snapping_threshold) {
 		std::vector<cv::Point2f> orig_polygon = polygon;
 
 		for (int i = 0; i < polygon.size(); i++) {
@@ -1285,59 +1292,28 @@ namespace util {
 			float max_len_ratio = 0;
 			cv::Point2f pt1, pt2;
 
-			for (int j = 0; j < ref_polygons.size(); j++) {
-				std::vector<cv::Point2f> contour = ref_polygons[j].contour.getActualPoints().points;
-
-				for (int k = 0; k < contour.size(); k++) {
-					int k2 = (k + 1) % contour.size();
+			for (auto& ring : ref_rings) {
+				for (int k = 0; k < ring.size(); k++) {
+					int k2 = (k + 1) % ring.size();
 
-					float dot_product = std::abs(dotProduct(contour[k2] - contour[k], polygon[i2] - polygon[i]) / length(contour[k2] - contour[k]) / length(polygon[i2] - polygon[i]));
+					float dot_product = std::abs(dotProduct(ring[k2] - ring[k], polygon[i2] - polygon[i]) / length(ring[k2] - ring[k]) / length(polygon[i2] - polygon[i]));
 					if (dot_product < 0.95) continue;
 
-					float ref_len = length(contour[k] - contour[k2]);
+					float ref_len = length(ring[k] - ring[k2]);
 					float len_ratio = ref_len / len;
 
 					std::vector<float> dist(4);
-					dist[0] = distance(contour[k], contour[k2], polygon[i], true);
-					dist[1] = distance(contour[k], contour[k2], polygon[i2], true);
-					dist[2] = distance(polygon[i], polygon[i2], contour[k], true);
-					dist[3] = distance(polygon[i], polygon[i2], contour[k2], true);
+					dist[0] = distance(ring[k], ring[k2], polygon[i], true);
+					dist[1] = distance(ring[k], ring[k2], polygon[i2], true);
+					dist[2] = distance(polygon[i], polygon[i2], ring[k], true);
+					dist[3] = distance(polygon[i], polygon[i2], ring[k2], true);
 
 					for (int l = 0; l < dist.size(); l++) {
 						for (int m = l + 1; m < dist.size(); m++) {
 							if (dist[l] < snapping_threshold && dist[m] < snapping_threshold && len_ratio > 0.1 && len_ratio > max_len_ratio) {
 								max_len_ratio = len_ratio;
-								pt1 = contour[k];
-								pt2 = contour[k2];
-							}
-						}
-					}
-				}
-
-				for (int k = 0; k < ref_polygons[j].holes.size(); k++) {
-					std::vector<cv::Point2f> hole = ref_polygons[j].holes[k].getActualPoints().points;
-					for (int l = 0; l < hole.size(); l++) {
-						int l2 = (l + 1) % hole.size();
-
-						float dot_product = std::abs(dotProduct(hole[l2] - hole[l], polygon[i2] - polygon[i]) / length(hole[l2] - hole[l]) / length(polygon[i2] - polygon[i]));
-						if (dot_product < 0.95) continue;
-
-						float ref_len = length(hole[l] - hole[l2]);
-						float len_ratio = ref_len / len;
-
-						std::vector<float> dist(4);
-						dist[0] = distance(hole[l], hole[l2], polygon[i], true);
-						dist[1] = distance(hole[l], hole[l2], polygon[i2], true);
-						dist[2] = distance(polygon[i], polygon[i2], hole[l], true);
-						dist[3] = distance(polygon[i], polygon[i2], hole[l2], true);
-
-						for (int m = 0; m < dist.size(); m++) {
-							for (int n = m + 1; n < dist.size(); n++) {
-								if (dist[m] < snapping_threshold && dist[n] < snapping_threshold && len_ratio > 0.1 && len_ratio > max_len_ratio) {
-									max_len_ratio = len_ratio;
-									pt1 = hole[l];
-									pt2 = hole[l2];
-								}
+								pt1 = ring[k];
+								pt2 = ring[k2];
 							}
 						}
 					}
@@ -1390,14 +1366,17 @@ namespace util {
 	void snapPolygon2(const std::vector<util::Polygon>& ref_polygons, util::Polygon& polygon, float snapping_threshold) {
 		util::Polygon ans;
 
+		// transform the reference polygons only once for all the rings of the polygon
+		std::vector<std::vector<cv::Point2f>> ref_rings = getActualRings(ref_polygons);
+
 		std::vector<cv::Point2f> contour = polygon.contour.getActualPoints().points;
-		util::snapPolygon2(ref_polygons, contour, snapping_threshold);
+		util::snapPolygonToRings2(ref_rings, contour, snapping_threshold);
 		ans.contour.points = contour;
 		if (!isSimple(ans.contour)) return;
 
 		for (int j = 0; j < polygon.holes.size(); j++) {
 			std::vector<cv::Point2f> hole = polygon.holes[j].getActualPoints().points;
-			util::snapPolygon2(ref_polygons, hole, snapping_threshold);
+			util::snapPolygonToRings2(ref_rings, hole, snapping_threshold);
 			ans.holes.push_back(hole);
 		}
 
@@ -1407,6 +1386,13 @@ namespace util {
 	}
 
 	void snapPolygon2(const std::vector<util::Polygon>& ref_polygons, std::vector<cv::Point2f>& polygon, float snapping_threshold) {
+		snapPolygonToRings2(getActualRings(ref_polygons), polygon, snapping_threshold);
+	}
+
+	/**
+	 * Snap the polygon to the reference rings, which are the actual points of the contours and the holes of the reference polygons.
+	 */
+	void snapPolygonToRings2(const std::vector<std::vector<cv::Point2f>>& ref_rings, std::vector<cv::Point2f>& polygon, float snapping_threshold) {
 		std::vector<cv::Point2f> orig_polygon = polygon;
 
 		for (int i = 0; i < polygon.size(); i++) {
@@ -1417,59 +1403,28 @@ namespace util {
 			float max_len_ratio = 0;
 			cv::Point2f pt1, pt2;
 
-			for (int j = 0; j < ref_polygons.size(); j++) {
-				std::vector<cv::Point2f> contour = ref_polygons[j].contour.getActualPoints().points;
-
-				for (int k = 0; k < contour.size(); k++) {
-					int k2 = (k + 1) % contour.size();
+			for (auto& ring : ref_rings) {
+				for (int k = 0; k < ring.size(); k++) {
+					int k2 = (k + 1) % ring.size();
 
-					float dot_product = std::abs(dotProduct(contour[k2] - contour[k], polygon[i2] - polygon[i]) / length(contour[k2] - contour[k]) / length(polygon[i2] - polygon[i]));
+					float dot_product = std::abs(dotProduct(ring[k2] - ring[k], polygon[i2] - polygon[i]) / length(ring[k2] - ring[k]) / length(polygon[i2] - polygon[i]));
 					if (dot_product < 0.95) continue;
 
-					float ref_len = length(contour[k] - contour[k2]);
+					float ref_len = length(ring[k] - ring[k2]);
 					float len_ratio = ref_len / len;
 
 					std::vector<float> dist(4);
-					dist[0] = distance(contour[k], contour[k2], polygon[i], true);
-					dist[1] = distance(contour[k], contour[k2], polygon[i2], true);
-					dist[2] = distance(polygon[i], polygon[i2], contour[k], true);
-					dist[3] = distance(polygon[i], polygon[i2], contour[k2], true);
+					dist[0] = distance(ring[k], ring[k2], polygon[i], true);
+					dist[1] = distance(ring[k], ring[k2], polygon[i2], true);
+					dist[2] = distance(polygon[i], polygon[i2], ring[k], true);
+					dist[3] = distance(polygon[i], polygon[i2], ring[k2], true);
 
 					for (int l = 0; l < dist.size(); l++) {
 						for (int m = l + 1; m < dist.size(); m++) {
 							if (dist[l] < snapping_threshold && dist[m] < snapping_threshold && len_ratio > 0.1 && len_ratio > max_len_ratio) {
 								max_len_ratio = len_ratio;
-								pt1 = contour[k];
-								pt2 = contour[k2];
-							}
-						}
-					}
-				}
-
-				for (int k = 0; k < ref_polygons[j].holes.size(); k++) {
-					std::vector<cv::Point2f> hole = ref_polygons[j].holes[k].getActualPoints().points;
-					for (int l = 0; l < hole.size(); l++) {
-						int l2 = (l + 1) % hole.size();
-
-						float dot_product = std::abs(dotProduct(hole[l2] - hole[l], polygon[i2] - polygon[i]) / length(hole[l2] - hole[l]) / length(polygon[i2] - polygon[i]));
-						if (dot_product < 0.95) continue;
-
-						float ref_len = length(hole[l] - hole[l2]);
-						float len_ratio = ref_len / len;
-
-						std::vector<float> dist(4);
-						dist[0] = distance(hole[l], hole[l2], polygon[i], true);
-						dist[1] = distance(hole[l], hole[l2], polygon[i2], true);
-						dist[2] = distance(polygon[i], polygon[i2], hole[l], true);
-						dist[3] = distance(polygon[i], polygon[i2], hole[l2], true);
-
-						for (int m = 0; m < dist.size(); m++) {
-							for (int n = m + 1; n < dist.size(); n++) {
-								if (dist[m] < snapping_threshold && dist[n] < snapping_threshold && len_ratio > 0.1 && len_ratio > max_len_ratio) {
-									max_len_ratio = len_ratio;
-									pt1 = hole[l];
-									pt2 = hole[l2];
-								}
+								pt1 = ring[k];
+								pt2 = ring[k2];
 							}
 						}
 					}
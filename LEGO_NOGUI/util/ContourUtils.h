@@ -7,6 +7,7 @@
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
+#include "Affine.h"
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Partition_traits_2.h>
 #include <CGAL/partition_2.h>
@@ -45,7 +46,7 @@ namespace util {
 		enum { TYPE_RECTANGLE, TYPE_TRIANGLE, TYPE_CURVE };
 
 	public:
-		cv::Mat_<float> mat;
+		Affine mat;
 
 	protected:
 		PrimitiveShape() {}
@@ -63,7 +64,7 @@ namespace util {
 		cv::Point2f max_pt;
 
 	public:
-		PrimitiveRectangle(const cv::Mat_<float>& mat, const cv::Point2f& min_pt, const cv::Point2f& max_pt);
+		PrimitiveRectangle(const Affine& mat, const cv::Point2f& min_pt, const cv::Point2f& max_pt);
 		~PrimitiveRectangle() {}
 		boost::shared_ptr<PrimitiveShape> clone() const;
 		std::vector<cv::Point2f> getActualPoints() const;
@@ -75,8 +76,8 @@ namespace util {
 		std::vector<cv::Point2f> points;
 
 	public:
-		PrimitiveTriangle(const cv::Mat_<float>& mat);
-		PrimitiveTriangle(const cv::Mat_<float>& mat, const std::vector<cv::Point2f>& points);
+		PrimitiveTriangle(const Affine& mat);
+		PrimitiveTriangle(const Affine& mat, const std::vector<cv::Point2f>& points);
 		~PrimitiveTriangle() {}
 		boost::shared_ptr<PrimitiveShape> clone() const;
 		std::vector<cv::Point2f> getActualPoints() const;
@@ -91,7 +92,7 @@ namespace util {
 		float radius;
 
 	public:
-		PrimitiveCurve(const cv::Mat_<float>& mat, float theta_start, float theta_end, const cv::Point2f &center, float radius);
+		PrimitiveCurve(const Affine& mat, float theta_start, float theta_end, const cv::Point2f &center, float radius);
 		~PrimitiveCurve() {}
 		boost::shared_ptr<PrimitiveShape> clone() const;
 		std::vector<cv::Point2f> getActualPoints() const;
@@ -100,15 +101,13 @@ namespace util {
 
 	class Ring {
 	public:
-		cv::Mat_<float> mat;
+		Affine mat;
 		std::vector<cv::Point2f> points;
 
 	public:
 		Ring();
-		Ring(const Ring& ring);
 		Ring(const std::vector<cv::Point2f>& points);
 
-		Ring& operator=(const Ring& ring);
 		Ring& operator=(const std::vector<cv::Point2f>& points);
 		const cv::Point2f& front() const;
 		cv::Point2f& front();
@@ -125,17 +124,18 @@ namespace util {
 		void pop_back();
 		void erase(std::vector<cv::Point2f>::iterator position);
 		void translate(float x, float y);
-		void transform(const cv::Mat_<float>& m);
+		void transform(const Affine& m);
 		void clockwise();
 		void counterClockwise();
 		cv::Point2f getActualPoint(int index) const;
 		Ring getActualPoints() const;
+		const std::vector<cv::Point2f>& actualPoints(std::vector<cv::Point2f>& buffer) const;
 		bool isSimple() const;
 	};
 
 	class Polygon {
 	public:
-		cv::Mat_<float> mat;
+		Affine mat;
 		Ring contour;
 		std::vector<Ring> holes;
 
@@ -148,7 +148,7 @@ namespace util {
 
 		Polygon clone() const;
 		void translate(float x, float y);
-		void transform(const cv::Mat_<float>& m);
+		void transform(const Affine& m);
 		void clockwise();
 		void counterClockwise();
 	};
@@ -159,7 +159,7 @@ namespace util {
 	bool isSimple(const Polygon& polygon);
 	bool isSimple(const Ring& points);
 	bool isSimple(const std::vector<cv::Point>& points);
-	void transform(std::vector<cv::Point2f>& polygon, const cv::Mat_<float>& m);
+	void transform(std::vector<cv::Point2f>& polygon, const Affine& m);
 	std::vector<cv::Point> removeRedundantPoint(const std::vector<cv::Point>& polygon);
 	Ring removeRedundantPoint(const Ring& polygon);
 	//std::vector<cv::Point2f> removeRedundantPoint(const std::vector<cv::Point2f>& polygon);
@@ -167,7 +167,7 @@ namespace util {
 
 	cv::Rect boundingBox(const std::vector<cv::Point>& polygon);
 	cv::Rect boundingBox(const std::vector<cv::Point2f>& polygon);
-	cv::Rect calculateOBB(const std::vector<cv::Point2f>& polygon, cv::Mat_<float>& trans_mat);
+	cv::Rect calculateOBB(const std::vector<cv::Point2f>& polygon, Affine& trans_mat);
 	bool withinPolygon(const cv::Point2f& pt, const Polygon& polygon);
 	bool withinPolygon(const cv::Point2f& pt, const Ring& ring);
 	bool withinPolygon(const Ring& inside_ring, const Ring& outside_ring);
@@ -187,11 +187,14 @@ namespace util {
 
 	void approxPolyDP(const std::vector<cv::Point2f>& input_polygon, std::vector<cv::Point2f>& output_polygon, double epsilon, bool closed);
 
+	std::vector<std::vector<cv::Point2f>> getActualRings(const std::vector<util::Polygon>& polygons);
 	void snapPolygon(const std::vector<util::Polygon>& ref_polygons, util::Polygon& polygon, float snapping_threshold);
 	void snapPolygon(const std::vector<util::Polygon>& ref_polygons, std::vector<cv::Point2f>& polygon, float snapping_threshold);
+	void snapPolygonToRings(const std::vector<std::vector<cv::Point2f>>& ref_rings, std::vector<cv::Point2f>& polygon, float snapping_threshold);
 	bool snapEdge(const cv::Point2f& p1, const cv::Point2f& p2, std::vector<cv::Point2f>& polygon, int i, int i2);
 	void snapPolygon2(const std::vector<util::Polygon>& ref_polygons, util::Polygon& polygon, float snapping_threshold);
 	void snapPolygon2(const std::vector<util::Polygon>& ref_polygons, std::vector<cv::Point2f>& polygon, float snapping_threshold);
+	void snapPolygonToRings2(const std::vector<std::vector<cv::Point2f>>& ref_rings, std::vector<cv::Point2f>& polygon, float snapping_threshold);
 	bool snapEdge2(const cv::Point2f& p1, const cv::Point2f& p2, std::vector<cv::Point2f>& polygon, int i, int i2);
 	float length(const cv::Point2f& pt);
 	float length(const cv::Point3f& pt);
@@ -13,43 +13,48 @@ namespace util {
 	 * - Too small connected components will be discarded.
 	 * - Too small contours will be discarded.
 	 */
-	std::vector<VoxelBuilding> DisjointVoxelData::disjoint(const std::vector<cv::Mat_<uchar>>& voxel_data, int voxel_value_threshold, float min_voxel_count_ratio) {
-		// initialize the clustering
-		std::vector<cv::Mat_<short>> building_clustering(voxel_data.size());
-		for (int h = 0; h < voxel_data.size(); h++) {
-			building_clustering[h] = cv::Mat_<short>(voxel_data[h].size(), -1);
-		}
+	std::vector<VoxelBuilding> DisjointVoxelData::disjoint(const std::vector<cv::Mat_<uchar>>& voxel_data, int voxel_value_threshold, float min_voxel_count_ratio, int num_threads) {
+		return disjoint(BinaryVolume(voxel_data, voxel_value_threshold), min_voxel_count_ratio, num_threads);
+	}
 
+	/**
+	 * Disjoint the buildings in the occupancy volume.
+	 * The 3D connected components and the connected components of each slice are labeled at once by RunLabeling.
+	 * The contours of the slices and the cleanup of the buildings are processed in parallel,
+	 * and the result does not depend on the number of threads.
+	 *
+	 * @param volume				occupancy volume
+	 * @param min_voxel_count_ratio	the buildings smaller than this ratio of the largest one are discarded
+	 * @param num_threads			the number of threads (0 - use all the hardware threads)
+	 * @return						buildings in the order of their first voxels, whose ids are their indices
+	 */
+	std::vector<VoxelBuilding> DisjointVoxelData::disjoint(const BinaryVolume& volume, float min_voxel_count_ratio, int num_threads) {
 		// Cluster the connected components in the voxel data.
-		// The clustering information will be stored in building_clustering.
 		setbuf(stdout, NULL);
 		printf("Clustering the voxel data...\n");
-		int building_id = 0;
-		int max_voxel_count = 0;
-		std::vector<int> voxel_counts;	// this array stores the number of voxels for each cluster.
-		for (int h = 0; h < voxel_data.size(); h++) {
-			for (int r = 0; r < voxel_data[h].rows; r++) {
-				for (int c = 0; c < voxel_data[h].cols; c++) {
-					if (voxel_data[h](r, c) > voxel_value_threshold && building_clustering[h](r, c) == -1) {
-						int voxel_count = disjointBuilding(voxel_data, building_clustering, r, c, h, building_id, voxel_value_threshold);
-						voxel_counts.push_back(voxel_count);
-						max_voxel_count = std::max(max_voxel_count, voxel_count);
-						building_id++;
-					}
-				}
-			}
-		}
+		RunLabeling labeling(volume);
 
-		int num_buildings = building_id;
+		long long max_voxel_count = 0;
+		for (int i = 0; i < labeling.numBuildings(); i++) {
+			max_voxel_count = std::max(max_voxel_count, labeling.building_voxel_counts[i]);
+		}
 
 		// Construct a graph structure for each connected component.
 		// The node of the graph represents a connected component in each slice.
+		// The building ids are assigned only to the remaining components, so the noise does not consume any id.
 		std::vector<VoxelBuilding> buildings;
-		for (int i = 0; i < num_buildings; i++) {
-			if (voxel_counts[i] < max_voxel_count * min_voxel_count_ratio) continue;
-			VoxelBuilding building_voxels = constructGraph(building_clustering, i);
-			buildings.push_back(building_voxels);
+		std::vector<int> building_indices(labeling.numBuildings(), -1);
+		for (int i = 0; i < labeling.numBuildings(); i++) {
+			if (labeling.building_voxel_counts[i] < max_voxel_count * min_voxel_count_ratio) continue;
+			building_indices[i] = buildings.size();
+			buildings.push_back(VoxelBuilding(buildings.size()));
 		}
+		ThreadPool pool(num_threads);
+		constructGraphs(labeling, building_indices, buildings, pool);
+
+		pool.parallelFor(buildings.size(), [&](int i) {
+			cleanupGraph(buildings[i]);
+		});
 
 		return buildings;
 	}
@@ -57,16 +62,17 @@ namespace util {
 	/**
 	 * Layer the building based on the threshold.
 	 * Similar contour of slices will be merged into one layer.
-	 * 
+	 * The IOUs that are computed are cached in the nodes, so layering the same building again with
+	 * another threshold only computes the IOUs that have not been needed so far (see annotateIOUs()).
 	 */
-	std::vector<std::shared_ptr<BuildingLayer>> DisjointVoxelData::layering(const util::VoxelBuilding& building_voxels, float threshold, int min_num_slices_per_layer) {
+	std::vector<std::shared_ptr<BuildingLayer>> DisjointVoxelData::layering(util::VoxelBuilding& building_voxels, float threshold, int min_num_slices_per_layer) {
 		std::vector<std::shared_ptr<BuildingLayer>> bottom_building_layers;
 
 		// layer buildings
 		for (int z = 0; z < building_voxels.node_stack.size(); z++) {
 			for (int i = 0; i < building_voxels.node_stack[z].size(); i++) {
-				if (building_voxels.node_stack[z][i]->parents.size() == 0) {
-					std::vector<std::shared_ptr<BuildingLayer>> layers = layeringBuilding(building_voxels.building_id, building_voxels.node_stack[z][i], threshold, min_num_slices_per_layer);
+				if (building_voxels.nodes[building_voxels.node_stack[z][i]].parents.size() == 0) {
+					std::vector<std::shared_ptr<BuildingLayer>> layers = layeringBuilding(building_voxels, building_voxels.node_stack[z][i], threshold, min_num_slices_per_layer);
 					bottom_building_layers.insert(bottom_building_layers.end(), layers.begin(), layers.end());
 				}
 			}
@@ -76,52 +82,358 @@ namespace util {
 	}
 
 	/**
-	 * Construct a graph structure of the building.
-	 * Each connected component in the slice will be a node of the graph. Too small contours will be discarded at this moment.
+	 * Disjoint the buildings by reading the slices one by one from the bottom.
+	 * The buildings are returned in the same order and with the same ids as disjoint(), i.e., the order of their first voxels.
+	 *
+	 * @param depth					the number of slices
+	 * @param read_slice			function that returns the z-th slice image
+	 * @param voxel_value_threshold	a voxel is occupied if its value is greater than this threshold
+	 * @param min_voxel_count_ratio	the buildings smaller than this ratio of the largest one are discarded
+	 * @return						buildings
 	 */
-	VoxelBuilding DisjointVoxelData::constructGraph(const std::vector<cv::Mat_<short>>& building_clustering, int building_id) {
-		VoxelBuilding building_voxels(building_id);
+	std::vector<VoxelBuilding> DisjointVoxelData::disjointStreaming(int depth, const std::function<cv::Mat_<uchar>(int)>& read_slice, int voxel_value_threshold, float min_voxel_count_ratio) {
+		std::vector<std::pair<long long, VoxelBuilding>> buildings;
+		long long max_voxel_count = 0;
+		disjointStreaming(depth, read_slice, [&](VoxelBuilding& building, long long voxel_count) {
+			max_voxel_count = std::max(max_voxel_count, voxel_count);
+			buildings.push_back({ voxel_count, VoxelBuilding() });
+			std::swap(buildings.back().second, building);
+		}, voxel_value_threshold);
+
+		std::sort(buildings.begin(), buildings.end(), [](const std::pair<long long, VoxelBuilding>& a, const std::pair<long long, VoxelBuilding>& b) {
+			return a.second.building_id < b.second.building_id;
+		});
+
+		// replace the provisional ids by the consecutive ids of the remaining buildings
+		std::vector<VoxelBuilding> ans;
+		for (auto& building : buildings) {
+			if (building.first < max_voxel_count * min_voxel_count_ratio) continue;
+			ans.push_back(VoxelBuilding());
+			std::swap(ans.back(), building.second);
+			ans.back().building_id = ans.size() - 1;
+		}
 
-		std::vector<std::shared_ptr<VoxelNode>> all_nodes;
+		return ans;
+	}
 
-		// initialize the clustering
-		std::vector<cv::Mat_<int>> clustering(building_clustering.size());
-		for (int h = 0; h < building_clustering.size(); h++) {
-			clustering[h] = cv::Mat_<int>(building_clustering[h].size(), -1);
-		}
+	/**
+	 * Disjoint the buildings by reading the slices one by one from the bottom.
+	 * Only the labels of the current and the previous slices are kept, and the connected components of
+	 * the slices are merged into buildings by union-find. A building is passed to emit_building as soon as
+	 * the current slice does not contain any part of it, so the memory usage is proportional to one slice
+	 * plus the buildings that are still growing.
+	 * The building ids are provisional; they increase in the order of the first voxel of the buildings, but they are not consecutive.
+	 *
+	 * @param depth					the number of slices
+	 * @param read_slice			function that returns the z-th slice image
+	 * @param emit_building			function that receives each completed building and its voxel count
+	 * @param voxel_value_threshold	a voxel is occupied if its value is greater than this threshold
+	 */
+	void DisjointVoxelData::disjointStreaming(int depth, const std::function<cv::Mat_<uchar>(int)>& read_slice, const std::function<void(VoxelBuilding&, long long)>& emit_building, int voxel_value_threshold) {
+		// a building that is still growing
+		struct GrowingBuilding {
+			int building_id;
+			long long voxel_count;
+			std::vector<std::pair<std::pair<int, int>, VoxelNode>> nodes;	// ((height, order in the slice), node whose parent edges refer to cluster ids)
+		};
+
+		// union-find over the slots of the growing buildings
+		std::vector<int> slot_parents;
+		std::vector<GrowingBuilding> slots;
+		std::vector<int> free_slots;
+		std::function<int(int)> find = [&](int slot) {
+			while (slot_parents[slot] != slot) {
+				slot_parents[slot] = slot_parents[slot_parents[slot]];
+				slot = slot_parents[slot];
+			}
+			return slot;
+		};
 
-		// perform 3D dfs to cluster the voxel data
-		int cluster_id = 0;
-		int max_voxel_count = 0;
-		std::vector<int> voxel_counts;	// this array stores the number of voxels for each cluster.
-		for (int h = 0; h < building_clustering.size(); h++) {
-			std::vector<std::shared_ptr<VoxelNode>> voxel_nodes_in_slice;
-			int max_voxel_count = 0;
-
-			// find connected components
-			for (int r = 0; r < building_clustering[h].rows; r++) {
-				for (int c = 0; c < building_clustering[h].cols; c++) {
-					if (building_clustering[h](r, c) == building_id && clustering[h](r, c) == -1) {
-						// create a voxel node
-						std::shared_ptr<VoxelNode> voxel_node(new VoxelNode(cluster_id, h));
-						all_nodes.push_back(voxel_node);
-						voxel_nodes_in_slice.push_back(voxel_node);
-
-						voxel_node->voxel_count = clusterBuilding(building_clustering[h], building_id, clustering, r, c, h, cluster_id, all_nodes);
-						int max_voxel_count = std::max(max_voxel_count, voxel_node->voxel_count);
-
-						// extract contour
-						voxel_node->contour = getPolygonFromCluster(clustering[h], cluster_id);
-						convertCoordinatesOfPolygon(voxel_node->contour, clustering[0].cols, clustering[0].rows);
-
-						cluster_id++;
+		setbuf(stdout, NULL);
+		printf("Clustering the voxel data...\n");
+		int width = 0;
+		int height = 0;
+		int next_building_id = 0;
+		int next_cluster_id = 0;
+		cv::Mat_<int> prev_labels;
+		std::vector<int> prev_order;
+		std::vector<int> prev_cluster_ids;
+		std::vector<int> prev_slots;
+		for (int h = 0; h <= depth; h++) {
+			cv::Mat_<int> labels;
+			std::vector<int> order;
+			std::vector<VoxelNode> nodes;
+			std::vector<int> cluster_ids;
+			std::vector<int> node_slots;
+			std::vector<int> absorbed_slots;
+
+			if (h < depth) {
+				cv::Mat_<uchar> slice = read_slice(h);
+				if (h == 0) {
+					width = slice.cols;
+					height = slice.rows;
+				}
+				else if (slice.cols != width || slice.rows != height) {
+					throw "The slice size does not match the volume size.";
+				}
+
+				// label the connected components of the slice
+				cv::Mat_<uchar> mask;
+				cv::compare(slice, voxel_value_threshold, mask, cv::CMP_GT);
+				cv::Mat stats;
+				cv::Mat centroids;
+				int num_labels = cv::connectedComponentsWithStats(mask, labels, stats, centroids, 4, CV_32S);
+
+				// Order the components by their first voxels as disjoint() does, and find the overlaps with the components of the previous slice.
+				order.resize(num_labels, -1);
+				std::vector<int> label_of_order;
+				std::vector<ComponentOverlap> overlaps;
+				for (int r = 0; r < height; r++) {
+					const int* label_row = labels.ptr<int>(r);
+					const int* prev_label_row = h > 0 ? prev_labels.ptr<int>(r) : NULL;
+					for (int c = 0; c < width; c++) {
+						int label = label_row[c];
+						if (label == 0) continue;
+						if (order[label] == -1) {
+							order[label] = label_of_order.size();
+							label_of_order.push_back(label);
+						}
+						if (prev_label_row != NULL && prev_label_row[c] > 0) {
+							int lower = prev_order[prev_label_row[c]];
+							if (overlaps.size() > 0 && overlaps.back().lower == lower && overlaps.back().upper == order[label]) {
+								overlaps.back().voxel_count++;
+							}
+							else {
+								overlaps.push_back(ComponentOverlap(lower, order[label], 1));
+							}
+						}
+					}
+				}
+				ComponentOverlap::accumulate(overlaps, 0);
+
+				// create a node for each component
+				nodes.resize(label_of_order.size());
+				cluster_ids.resize(label_of_order.size());
+				node_slots.resize(label_of_order.size(), -1);
+				for (int i = 0; i < label_of_order.size(); i++) {
+					int label = label_of_order[i];
+					cv::Rect bbox(stats.at<int>(label, cv::CC_STAT_LEFT), stats.at<int>(label, cv::CC_STAT_TOP), stats.at<int>(label, cv::CC_STAT_WIDTH), stats.at<int>(label, cv::CC_STAT_HEIGHT));
+					cluster_ids[i] = next_cluster_id++;
+					nodes[i] = VoxelNode(cluster_ids[i], h);
+					nodes[i].voxel_count = stats.at<int>(label, cv::CC_STAT_AREA);
+					cv::Mat_<uchar> roi_slice;
+					cv::compare(labels(bbox), label, roi_slice, cv::CMP_EQ);
+					nodes[i].mask = BitMask(roi_slice, bbox.x, bbox.y);
+					Polygon contour = getPolygonFromSlice(roi_slice, bbox.x, bbox.y);
+					convertCoordinatesOfPolygon(contour, width, height);
+					nodes[i].contour = std::make_shared<const Polygon>(contour);
+				}
+
+				// update the edges and merge the buildings that are connected through this slice
+				// (the children edges are added when the building is completed)
+				for (auto& overlap : overlaps) {
+					nodes[overlap.upper].parents.push_back(VoxelEdge(prev_cluster_ids[overlap.lower], overlap.voxel_count));
+
+					int slot = find(prev_slots[overlap.lower]);
+					if (node_slots[overlap.upper] == -1) {
+						node_slots[overlap.upper] = slot;
+					}
+					else {
+						int slot2 = find(node_slots[overlap.upper]);
+						if (slot2 != slot) {
+							// merge the smaller building into the larger one, and keep the smaller id
+							if (slots[slot].nodes.size() < slots[slot2].nodes.size()) std::swap(slot, slot2);
+							slots[slot].building_id = std::min(slots[slot].building_id, slots[slot2].building_id);
+							slots[slot].voxel_count += slots[slot2].voxel_count;
+							slots[slot].nodes.insert(slots[slot].nodes.end(), std::make_move_iterator(slots[slot2].nodes.begin()), std::make_move_iterator(slots[slot2].nodes.end()));
+							slots[slot2].nodes.clear();
+							slot_parents[slot2] = slot;
+							absorbed_slots.push_back(slot2);
+						}
+					}
+				}
+
+				// the components without a parent start new buildings
+				for (int i = 0; i < nodes.size(); i++) {
+					if (node_slots[i] == -1) {
+						int slot;
+						if (free_slots.size() > 0) {
+							slot = free_slots.back();
+							free_slots.pop_back();
+						}
+						else {
+							slot = slots.size();
+							slots.push_back(GrowingBuilding());
+							slot_parents.push_back(slot);
+						}
+						slot_parents[slot] = slot;
+						slots[slot].building_id = next_building_id++;
+						slots[slot].voxel_count = 0;
+						node_slots[i] = slot;
 					}
+
+					node_slots[i] = find(node_slots[i]);
+					slots[node_slots[i]].voxel_count += nodes[i].voxel_count;
+					slots[node_slots[i]].nodes.push_back({ { h, i }, std::move(nodes[i]) });
 				}
 			}
 
-			building_voxels.node_stack.push_back(voxel_nodes_in_slice);
+			// The buildings of the previous slice that do not reach this slice are completed.
+			std::vector<bool> growing(slots.size(), false);
+			for (int i = 0; i < node_slots.size(); i++) {
+				growing[node_slots[i]] = true;
+			}
+			for (int i = 0; i < prev_slots.size(); i++) {
+				int slot = find(prev_slots[i]);
+				if (growing[slot]) continue;
+				growing[slot] = true;
+
+				VoxelBuilding building_voxels(slots[slot].building_id);
+				building_voxels.node_stack.resize(depth);
+				std::sort(slots[slot].nodes.begin(), slots[slot].nodes.end(), [](const std::pair<std::pair<int, int>, VoxelNode>& a, const std::pair<std::pair<int, int>, VoxelNode>& b) {
+					return a.first < b.first;
+				});
+				std::unordered_map<int, int> node_indices;	// cluster id -> index of the node
+				for (auto& node : slots[slot].nodes) {
+					node_indices[node.second.cluster_id] = building_voxels.nodes.size();
+					building_voxels.node_stack[node.first.first].push_back(building_voxels.nodes.size());
+					building_voxels.nodes.push_back(std::move(node.second));
+				}
+
+				// convert the parent edges to the node indices, and add the children edges
+				for (int j = 0; j < building_voxels.nodes.size(); j++) {
+					for (auto& parent : building_voxels.nodes[j].parents) {
+						parent.node = node_indices[parent.node];
+						building_voxels.nodes[parent.node].children.push_back(VoxelEdge(j, parent.voxel_count));
+					}
+				}
+				long long voxel_count = slots[slot].voxel_count;
+				slots[slot].nodes.clear();
+				slots[slot].nodes.shrink_to_fit();
+				free_slots.push_back(slot);
+
+				cleanupGraph(building_voxels);
+				emit_building(building_voxels, voxel_count);
+			}
+
+			// the absorbed slots are not referred any more
+			free_slots.insert(free_slots.end(), absorbed_slots.begin(), absorbed_slots.end());
+
+			prev_labels = labels;
+			prev_order = order;
+			prev_cluster_ids = cluster_ids;
+			prev_slots = node_slots;
+		}
+	}
+
+	/**
+	 * Construct the graph structures of all the buildings in one sweep over the slices.
+	 * Each connected component in the slice will be a node of the graph, and the overlapping components
+	 * of the adjacent slices are connected by edges.
+	 * The nodes are created in order first, so that the cluster ids do not depend on the scheduling,
+	 * and then the contours of the slices are extracted in parallel.
+	 *
+	 * @param labeling			labeling of the volume
+	 * @param building_indices	the index in buildings for each building of the labeling (-1 - the building is discarded)
+	 * @param buildings			buildings whose node stacks are filled
+	 * @param pool				thread pool for the contour extraction
+	 */
+	void DisjointVoxelData::constructGraphs(const RunLabeling& labeling, const std::vector<int>& building_indices, std::vector<VoxelBuilding>& buildings, ThreadPool& pool) {
+		for (auto& building_voxels : buildings) {
+			building_voxels.node_stack.resize(labeling.depth);
+		}
+
+		// create a node for each component of the remaining buildings
+		std::vector<int> component_nodes(labeling.components.size(), -1);
+		std::vector<int> slices;	// the slices that have at least one node
+		for (int h = 0; h < labeling.depth; h++) {
+			for (int i = labeling.slice_component_offsets[h]; i < labeling.slice_component_offsets[h + 1]; i++) {
+				int index = building_indices[labeling.components[i].building];
+				if (index < 0) continue;
+
+				VoxelBuilding& building_voxels = buildings[index];
+				component_nodes[i] = building_voxels.nodes.size();
+				building_voxels.node_stack[h].push_back(component_nodes[i]);
+				building_voxels.nodes.push_back(VoxelNode(component_nodes[i], h));
+				building_voxels.nodes.back().voxel_count = labeling.components[i].voxel_count;
+				if (slices.size() == 0 || slices.back() != h) slices.push_back(h);
+			}
+		}
+
+		// The slices only share the nodes of other slices through the edges, so their contours are independent.
+		pool.parallelFor(slices.size(), [&](int i) {
+			extractContours(labeling, slices[i], building_indices, component_nodes, buildings);
+		});
+
+		// update the edges
+		for (auto& overlap : labeling.overlaps) {
+			if (component_nodes[overlap.lower] < 0) continue;
+			VoxelBuilding& building_voxels = buildings[building_indices[labeling.components[overlap.lower].building]];
+			int parent_node = component_nodes[overlap.lower];
+			int child_node = component_nodes[overlap.upper];
+			building_voxels.nodes[parent_node].children.push_back(VoxelEdge(child_node, overlap.voxel_count));
+			building_voxels.nodes[child_node].parents.push_back(VoxelEdge(parent_node, overlap.voxel_count));
+		}
+	}
+
+	/**
+	 * Extract the contours of the nodes in the h-th slice.
+	 * The runs of the slice are grouped by component, and each component is rasterized from its own runs
+	 * into an image of its bounding box, so the cost is proportional to the area of the components.
+	 *
+	 * @param labeling			labeling of the volume
+	 * @param h					height of the slice
+	 * @param building_indices	the index in buildings for each building of the labeling (-1 - the building is discarded)
+	 * @param component_nodes	the node index of each component (-1 - the component is discarded)
+	 * @param buildings			buildings whose nodes receive the contours
+	 */
+	void DisjointVoxelData::extractContours(const RunLabeling& labeling, int h, const std::vector<int>& building_indices, const std::vector<int>& component_nodes, std::vector<VoxelBuilding>& buildings) {
+		int first_component = labeling.slice_component_offsets[h];
+		int num_components = labeling.slice_component_offsets[h + 1] - first_component;
+		int first_run = labeling.slice_run_offsets[h];
+		int num_runs = labeling.slice_run_offsets[h + 1] - first_run;
+
+		// group the runs by component (the runs keep the (y, x) order in each group)
+		std::vector<int> run_offsets(num_components + 1, 0);
+		for (int i = first_run; i < first_run + num_runs; i++) {
+			run_offsets[labeling.runs[i].component - first_component + 1]++;
+		}
+		for (int j = 0; j < num_components; j++) {
+			run_offsets[j + 1] += run_offsets[j];
+		}
+		std::vector<int> component_runs(num_runs);
+		std::vector<int> next_run(run_offsets.begin(), run_offsets.end() - 1);
+		for (int i = first_run; i < first_run + num_runs; i++) {
+			component_runs[next_run[labeling.runs[i].component - first_component]++] = i;
+		}
+
+		// extract contour
+		for (int j = 0; j < num_components; j++) {
+			int i = first_component + j;
+			if (component_nodes[i] < 0) continue;
+
+			VoxelNode& voxel_node = buildings[building_indices[labeling.components[i].building]].nodes[component_nodes[i]];
+			const cv::Rect& bbox = labeling.components[i].bbox;
+			cv::Mat_<uchar> roi_slice = cv::Mat_<uchar>::zeros(bbox.size());
+			voxel_node.mask = BitMask(bbox);
+			for (int k = run_offsets[j]; k < run_offsets[j + 1]; k++) {
+				const VoxelRun& run = labeling.runs[component_runs[k]];
+				uchar* row = roi_slice.ptr<uchar>(run.y - bbox.y);
+				std::fill(row + run.x0 - bbox.x, row + run.x1 - bbox.x, 255);
+				voxel_node.mask.setRun(run.y, run.x0, run.x1);
+			}
+
+			Polygon contour = getPolygonFromSlice(roi_slice, bbox.x, bbox.y);
+			convertCoordinatesOfPolygon(contour, labeling.width, labeling.height);
+			voxel_node.contour = std::make_shared<const Polygon>(contour);
 		}
+	}
 
+	/**
+	 * Remove the noise from the graph of the building, and convert the graph to a tree.
+	 * The node stack of the building has to have one entry for each slice of the volume.
+	 */
+	void DisjointVoxelData::cleanupGraph(VoxelBuilding& building_voxels) {
 		// Find the height where the voxel count sum is the largest
 		int max_voxel_count_sum = 0;
 		int max_voxel_count_height = -1;
@@ -141,8 +453,8 @@ namespace util {
 				building_voxels.node_stack.erase(building_voxels.node_stack.begin(), building_voxels.node_stack.begin() + i + 1);
 
 				// clear the parent edges
-				for (auto voxel_node : building_voxels.node_stack[0]) {
-					voxel_node->parents.clear();
+				for (int node : building_voxels.node_stack[0]) {
+					building_voxels.nodes[node].parents.clear();
 				}
 
 				break;
@@ -155,11 +467,11 @@ namespace util {
 
 			int max_area = 0;
 			for (int i = 0; i < building_voxels.node_stack[z].size(); i++) {
-				max_area = std::max(max_area, building_voxels.node_stack[z][i]->voxel_count);
+				max_area = std::max(max_area, building_voxels.nodes[building_voxels.node_stack[z][i]].voxel_count);
 			}
 
 			for (int i = building_voxels.node_stack[z].size() - 1; i >= 0; i--) {
-				if (building_voxels.node_stack[z][i]->voxel_count < max_area * 0.1) {
+				if (building_voxels.nodes[building_voxels.node_stack[z][i]].voxel_count < max_area * 0.1) {
 					building_voxels.removeNode(z, i);
 				}
 			}
@@ -169,156 +481,37 @@ namespace util {
 		// This should work for now, but the graph structure may be desired in the future.
 		for (int z = 1; z < building_voxels.node_stack.size(); z++) {
 			for (int i = 0; i < building_voxels.node_stack[z].size(); i++) {
-				if (building_voxels.node_stack[z][i]->parents.size() > 1) {
+				VoxelNode& voxel_node = building_voxels.nodes[building_voxels.node_stack[z][i]];
+				if (voxel_node.parents.size() > 1) {
 					int max_area = 0;
-					std::shared_ptr<VoxelNode> max_parent_node;
-					for (auto it = building_voxels.node_stack[z][i]->parents.begin(); it != building_voxels.node_stack[z][i]->parents.end(); it++) {
-						if (it->first->voxel_count > max_area) {
-							max_area = it->first->voxel_count;
-							max_parent_node = it->first;
+					VoxelEdge max_parent;
+					for (auto& parent : voxel_node.parents) {
+						if (building_voxels.nodes[parent.node].voxel_count > max_area) {
+							max_area = building_voxels.nodes[parent.node].voxel_count;
+							max_parent = parent;
 						}
 					}
 
-					building_voxels.node_stack[z][i]->parents.clear();
-					building_voxels.node_stack[z][i]->parents[max_parent_node] = true;
-				}
-			}
-		}
-
-		return building_voxels;
-	}
-
-	/**
-	 * Traverse the connected voxels with value greater than the threshold and are not visited yet.
-	 *
-	 * @param voxel_data			voxel data
-	 * @param building_clustering	save the clustering information
-	 * @param r						row of current voxel
-	 * @param c						column of current voxel
-	 * @param h						height of current voxel
-	 * @param building_id			building id
-	 * @param voxel_value_threshold	threshold
-	 * @return						the voxel count of the connected component
-	 */
-	int DisjointVoxelData::disjointBuilding(const std::vector<cv::Mat_<uchar>>&voxel_data, std::vector<cv::Mat_<short>>& building_clustering, int r, int c, int h, int building_id, int voxel_value_threshold) {
-		const std::vector<std::pair<int, std::pair<int, int>>> dirs = { { 0, { 1, 0 } }, { 0, { -1, 0 } }, { 0, { 0, 1 } }, { 0, { 0, -1 } }, { 1, { 0, 0 } }, { -1, { 0, 0 } } };
-
-		int R = voxel_data[0].rows;
-		int C = voxel_data[0].cols;
-
-		std::queue<std::pair<int, std::pair<int, int>>> Q;
-		Q.push({ h, { r, c } });
-
-		building_clustering[h](r, c) = building_id;
-		int count = 0;
-
-		while (!Q.empty()) {
-			int h = Q.front().first;
-			int r = Q.front().second.first;
-			int c = Q.front().second.second;
-			Q.pop();
-			count++;
-
-			for (int i = 0; i < dirs.size(); i++) {
-				int h2 = h + dirs[i].first;
-				int r2 = r + dirs[i].second.first;
-				int c2 = c + dirs[i].second.second;
-
-				if (r2 >= 0 && r2 < R && c2 >= 0 && c2 < C && h2 >= 0 && h2 < voxel_data.size() && voxel_data[h2](r2, c2) > voxel_value_threshold && building_clustering[h2](r2, c2) == -1) {
-					building_clustering[h2](r2, c2) = building_id;
-					Q.push({ h2, { r2, c2 } });
+					voxel_node.parents.clear();
+					voxel_node.parents.push_back(max_parent);
 				}
 			}
 		}
-
-		return count;
 	}
 
 	/**
-	 * Traverse the voxels with specified building id in the slice and are not visited yet.
+	 * Extract the polygon of the cluster in the cropped slice image.
 	 *
-	 * @param building_clustering	building clustering data (only the voxels with value of building_id will be traversed)
-	 * @param building_id			building id
-	 * @param clustering			save the clustering information
-	 * @param r						row of current voxel
-	 * @param c						column of current voxel
-	 * @param h						height of current voxel
-	 * @param cluster_id			current cluster id
-	 * @param voxel_nodes			generated voxel nodes
-	 * @return						the voxel count of the connected component
+	 * @param roi_slice	slice image cropped to the bounding box of the cluster (255 - cluster, 0 - others)
+	 * @param x			x coordinate of the top left corner of the crop
+	 * @param y			y coordinate of the top left corner of the crop
+	 * @return			polygon in the coordinates of the whole slice
 	 */
-	int DisjointVoxelData::clusterBuilding(const cv::Mat_<short>& building_clustering, int building_id, std::vector<cv::Mat_<int>>&clustering, int r, int c, int h, int cluster_id, std::vector<std::shared_ptr<VoxelNode>>& voxel_nodes) {
-		const std::vector<std::pair<int, int>> dirs = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
-
-		int R = building_clustering.rows;
-		int C = building_clustering.cols;
-
-		std::queue<std::pair<int, int>> Q;
-		Q.push({ r, c });
-
-		clustering[h](r, c) = cluster_id;
-		int count = 0;
-
-		while (!Q.empty()) {
-			int r = Q.front().first;
-			int c = Q.front().second;
-			Q.pop();
-			count++;
-			if (h > 0 && clustering[h - 1](r, c) >= 0) {
-				// update the edges
-				int parent_cluster_id = clustering[h - 1](r, c);
-				voxel_nodes[parent_cluster_id]->children[voxel_nodes[cluster_id]] = true;
-				voxel_nodes[cluster_id]->parents[voxel_nodes[parent_cluster_id]] = true;
-			}
-
-			for (int i = 0; i < dirs.size(); i++) {
-				int r2 = r + dirs[i].first;
-				int c2 = c + dirs[i].second;
-
-				if (r2 >= 0 && r2 < R && c2 >= 0 && c2 < C && building_clustering(r2, c2) == building_id && clustering[h](r2, c2) == -1) {
-					clustering[h](r2, c2) = cluster_id;
-					Q.push({ r2, c2 });
-				}
-			}
-		}
-
-		return count;
-	}
-
-	cv::Mat_<uchar> DisjointVoxelData::getSliceOfCluster(const cv::Mat_<int>& clustering, int cluster_id, int& min_x, int& min_y, int& max_x, int& max_y) {
-		min_x = std::numeric_limits<int>::max();
-		min_y = std::numeric_limits<int>::max();
-		max_x = 0;
-		max_y = 0;
-
-		bool found = false;
-
-		cv::Mat_<uchar> ans = cv::Mat_<uchar>::zeros(clustering.size());
-		for (int r = 0; r < clustering.rows; r++) {
-			for (int c = 0; c < clustering.cols; c++) {
-				if (clustering(r, c) == cluster_id) {
-					ans(r, c) = 255;
-					min_x = std::min(min_x, c);
-					min_y = std::min(min_y, r);
-					max_x = std::max(max_x, c);
-					max_y = std::max(max_y, r);
-					found = true;
-				}
-			}
-		}
-
-		if (!found) throw "No specified cluster was found.";
-
-		return ans;
-	}
-
-	Polygon DisjointVoxelData::getPolygonFromCluster(const cv::Mat_<int>& clustering, int cluster_id) {
-		int min_x, min_y, max_x, max_y;
-		cv::Mat_<uchar> slice = getSliceOfCluster(clustering, cluster_id, min_x, min_y, max_x, max_y);
-		cv::Mat_<uchar> roi_slice(slice, cv::Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1));
+	Polygon DisjointVoxelData::getPolygonFromSlice(const cv::Mat_<uchar>& roi_slice, int x, int y) {
 		std::vector<Polygon> polygons = findContours(roi_slice, true);
+		if (polygons.size() == 0) throw "No contour was found for the cluster.";
 		for (int i = 0; i < polygons.size(); i++) {
-			polygons[i].translate(min_x, min_y);
+			polygons[i].translate(x, y);
 		}
 
 		return polygons[0];
@@ -346,54 +539,64 @@ namespace util {
 		}
 	}
 	
+	/**
+	 * Compute the IOU between each node and its children in advance, which does not depend on the threshold.
+	 * The IOUs with the deeper descendants are computed by layering() when it needs them and are cached as well,
+	 * so annotating every level would cost O(H^2) for a tower of H slices while layering rarely goes that deep.
+	 *
+	 * @param buildings		buildings
+	 * @param num_threads	the number of threads (0 - use all the hardware threads)
+	 */
+	void DisjointVoxelData::annotateIOUs(std::vector<VoxelBuilding>& buildings, int num_threads) {
+		ThreadPool pool(num_threads);
+		pool.parallelFor(buildings.size(), [&](int i) {
+			VoxelBuilding& building_voxels = buildings[i];
+			for (int node = 0; node < building_voxels.nodes.size(); node++) {
+				std::vector<int> children = childNodes(building_voxels, { node });
+				if (children.size() > 0) descendantIOU(building_voxels, node, 0, children, 0.0f);
+			}
+		});
+	}
+
 	/**
 	 * Layer the building.
 	 */
-	std::vector<std::shared_ptr<BuildingLayer>> DisjointVoxelData::layeringBuilding(int building_id, const std::shared_ptr<VoxelNode>& voxel_node, float threshold, int min_num_slices_per_layer) {
+	std::vector<std::shared_ptr<BuildingLayer>> DisjointVoxelData::layeringBuilding(VoxelBuilding& building_voxels, int node, float threshold, int min_num_slices_per_layer) {
+		int building_id = building_voxels.building_id;
+		const std::vector<VoxelNode>& nodes = building_voxels.nodes;	// the nodes are not added or removed during layering
+
 		// create the bottom layer
-		std::shared_ptr<BuildingLayer> bottom_building_layer(std::shared_ptr<BuildingLayer>(new BuildingLayer(building_id, voxel_node->height, voxel_node->height + 1)));
-		bottom_building_layer->raw_footprints.push_back({ voxel_node->contour });
+		std::shared_ptr<BuildingLayer> bottom_building_layer(std::shared_ptr<BuildingLayer>(new BuildingLayer(building_id, nodes[node].height, nodes[node].height + 1)));
+		bottom_building_layer->raw_footprints.push_back(RawFootprint({ nodes[node].contour }));
 
 		// initialize queue
-		std::queue<std::pair<std::shared_ptr<VoxelNode>, std::shared_ptr<BuildingLayer>>> Q;
-		Q.push({ voxel_node, bottom_building_layer });
+		std::queue<std::pair<int, std::shared_ptr<BuildingLayer>>> Q;
+		Q.push({ node, bottom_building_layer });
 
 		while (!Q.empty()) {
-			std::shared_ptr<VoxelNode> voxel_node = Q.front().first;
+			int node = Q.front().first;
 			std::shared_ptr<BuildingLayer> layer = Q.front().second;
 			Q.pop();
 
-			std::vector<Polygon> cur_polygon;
-			cur_polygon.push_back(voxel_node->contour);
-
-			std::unordered_map<std::shared_ptr<VoxelNode>, bool> child_nodes = voxel_node->children;
+			std::vector<int> child_nodes = childNodes(building_voxels, { node });
 
-			while (child_nodes.size() > 0) {
-				std::vector<Polygon> child_polygons;
-				for (auto it = child_nodes.begin(); it != child_nodes.end(); it++) {
-					child_polygons.push_back(it->first->contour);
-				}
-
-				if (calculateIOU(cur_polygon, child_polygons) >= threshold) {
+			for (int level = 0; child_nodes.size() > 0; level++) {
+				if (descendantIOU(building_voxels, node, level, child_nodes, threshold) >= threshold) {
 					// merge nodes
-					std::unordered_map<std::shared_ptr<VoxelNode>, bool> old_children = child_nodes;
-					child_nodes.clear();
-					layer->raw_footprints.push_back({});
-					for (auto it = old_children.begin(); it != old_children.end(); it++) {
-						for (auto it2 = it->first->children.begin(); it2 != it->first->children.end(); it2++) {
-							child_nodes[it2->first] = true;
-						}
-						layer->raw_footprints.back().push_back(it->first->contour);
-						layer->top_height = it->first->height + 1;
+					layer->raw_footprints.push_back(RawFootprint());
+					for (int child_node : child_nodes) {
+						layer->raw_footprints.back().polygons.push_back(nodes[child_node].contour);
+						layer->top_height = nodes[child_node].height + 1;
 					}
+					child_nodes = childNodes(building_voxels, child_nodes);
 				}
 				else {
 					// create new layers
-					for (auto it = child_nodes.begin(); it != child_nodes.end(); it++) {
-						std::shared_ptr<BuildingLayer> child_layer(std::shared_ptr<BuildingLayer>(new BuildingLayer(building_id, it->first->height, it->first->height + 1)));
-						child_layer->raw_footprints.push_back({ it->first->contour });
+					for (int child_node : child_nodes) {
+						std::shared_ptr<BuildingLayer> child_layer(std::shared_ptr<BuildingLayer>(new BuildingLayer(building_id, nodes[child_node].height, nodes[child_node].height + 1)));
+						child_layer->raw_footprints.push_back(RawFootprint({ nodes[child_node].contour }));
 						layer->children.push_back(child_layer);
-						Q.push({ it->first, child_layer });
+						Q.push({ child_node, child_layer });
 					}
 
 					break;
@@ -410,6 +613,98 @@ namespace util {
 		return root_layer->children;
 	}
 
+	/**
+	 * Return the union of the children of the nodes in the ascending order.
+	 */
+	std::vector<int> DisjointVoxelData::childNodes(const VoxelBuilding& building_voxels, const std::vector<int>& nodes) {
+		std::vector<int> ans;
+		for (int node : nodes) {
+			for (auto& child : building_voxels.nodes[node].children) {
+				ans.push_back(child.node);
+			}
+		}
+
+		// the children of different nodes may share the same grandchild
+		std::sort(ans.begin(), ans.end());
+		ans.erase(std::unique(ans.begin(), ans.end()), ans.end());
+
+		return ans;
+	}
+
+	/**
+	 * Return the IOU between the node and its descendants (level + 1) slices above, using the cache of the node.
+	 * If the ratio of their areas is already below the threshold, the ratio is returned as an upper bound of the IOU
+	 * without looking at the voxels, and it is cached as a negative value.
+	 *
+	 * @param building_voxels	building
+	 * @param node				node
+	 * @param level				level of the descendants (0 - children)
+	 * @param descendants		the descendants of the level
+	 * @param threshold			layering threshold
+	 * @return					IOU, or its upper bound that is less than the threshold
+	 */
+	double DisjointVoxelData::descendantIOU(VoxelBuilding& building_voxels, int node, int level, const std::vector<int>& descendants, float threshold) {
+		std::vector<double>& ious = building_voxels.nodes[node].descendant_ious;
+		if (level < ious.size()) {
+			if (ious[level] >= 0) return ious[level];
+			if (-ious[level] < threshold) return -ious[level];
+		}
+
+		// the IOU cannot reach the threshold if the areas are too different
+		long long voxel_count = building_voxels.nodes[node].voxel_count;
+		long long descendant_voxel_count = 0;
+		for (int descendant : descendants) {
+			descendant_voxel_count += building_voxels.nodes[descendant].voxel_count;
+		}
+		double max_iou = (double)std::min(voxel_count, descendant_voxel_count) / std::max(voxel_count, descendant_voxel_count);
+
+		double iou;
+		double cached_value;
+		if (max_iou < threshold) {
+			iou = max_iou;
+			cached_value = -max_iou;
+		}
+		else {
+			iou = calculateIOU(building_voxels, node, descendants);
+			cached_value = iou;
+		}
+
+		if (level < ious.size()) {
+			ious[level] = cached_value;
+		}
+		else {
+			ious.push_back(cached_value);
+		}
+
+		return iou;
+	}
+
+	/**
+	 * Calculate the IOU between the node and the set of the nodes in another slice.
+	 * The bit masks of the nodes are used if they are available, otherwise the contours are rasterized.
+	 */
+	double DisjointVoxelData::calculateIOU(const VoxelBuilding& building_voxels, int node, const std::vector<int>& nodes2) {
+		bool has_masks = !building_voxels.nodes[node].mask.empty();
+		for (int node2 : nodes2) {
+			if (building_voxels.nodes[node2].mask.empty()) has_masks = false;
+		}
+
+		if (has_masks) {
+			std::vector<const BitMask*> masks2;
+			for (int node2 : nodes2) {
+				masks2.push_back(&building_voxels.nodes[node2].mask);
+			}
+			return BitMask::calculateIOU({ &building_voxels.nodes[node].mask }, masks2);
+		}
+		else {
+			std::vector<Polygon> polygons2;
+			for (int node2 : nodes2) {
+				polygons2.push_back(*building_voxels.nodes[node2].contour);
+			}
+			return util::calculateIOU(std::vector<Polygon>({ *building_voxels.nodes[node].contour }), polygons2);
+		}
+	}
+
 	/**
 	* Remove too thin layer by merging it to the one beneath.
 	*
@@ -433,10 +728,8 @@ namespace util {
 						grandchild_layer->bottom_height = child_layer->bottom_height;
 						//grandchild_layer->raw_footprints.insert(grandchild_layer->raw_footprints.begin(), child_layer->raw_footprints.begin(), child_layer->raw_footprints.end());
 
-						// add the bottom slice of the grandchild layer for N times, where N is the number of the slices in the child layer
-						for (int j = 0; j < child_layer->raw_footprints.size(); j++) {
-							grandchild_layer->raw_footprints.insert(grandchild_layer->raw_footprints.begin(), grandchild_layer->raw_footprints[0]);
-						}
+						// let the bottom slice of the grandchild layer count N times more, where N is the number of the slices in the child layer
+						grandchild_layer->raw_footprints[0].num_slices += child_layer->numRawSlices();
 					}
 				}
 			}
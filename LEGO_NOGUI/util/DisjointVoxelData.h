@@ -2,7 +2,11 @@
 
 #include <vector>
 #include <unordered_map>
+#include <functional>
 #include <opencv2/opencv.hpp>
+#include "BinaryVolume.h"
+#include "RunLabeling.h"
+#include "ThreadPool.h"
 #include "BuildingLayer.h"
 #include "ContourUtils.h"
 #include "VoxelBuilding.h"
@@ -14,17 +18,23 @@ namespace util {
 		DisjointVoxelData();
 
 	public:
-		static std::vector<VoxelBuilding> disjoint(const std::vector<cv::Mat_<uchar>>& voxel_data, int voxel_value_threshold = 128, float min_voxel_count_ratio = 0.1);
-		static std::vector<std::shared_ptr<BuildingLayer>> layering(const util::VoxelBuilding& building_voxels, float threshold, int min_num_slices_per_layer);
+		static std::vector<VoxelBuilding> disjoint(const std::vector<cv::Mat_<uchar>>& voxel_data, int voxel_value_threshold = 128, float min_voxel_count_ratio = 0.1, int num_threads = 0);
+		static std::vector<VoxelBuilding> disjoint(const BinaryVolume& volume, float min_voxel_count_ratio = 0.1, int num_threads = 0);
+		static std::vector<VoxelBuilding> disjointStreaming(int depth, const std::function<cv::Mat_<uchar>(int)>& read_slice, int voxel_value_threshold = 128, float min_voxel_count_ratio = 0.1);
+		static void disjointStreaming(int depth, const std::function<cv::Mat_<uchar>(int)>& read_slice, const std::function<void(VoxelBuilding&, long long)>& emit_building, int voxel_value_threshold = 128);
+		static std::vector<std::shared_ptr<BuildingLayer>> layering(util::VoxelBuilding& building_voxels, float threshold, int min_num_slices_per_layer);
+		static void annotateIOUs(std::vector<VoxelBuilding>& buildings, int num_threads = 0);
 
 	private:
-		static VoxelBuilding constructGraph(const std::vector<cv::Mat_<short>>& building_clustering, int building_id);
-		static int disjointBuilding(const std::vector<cv::Mat_<uchar>>& voxel_data, std::vector<cv::Mat_<short>>& building_clustering, int r, int c, int h, int building_id, int voxel_value_threshold);
-		static int clusterBuilding(const cv::Mat_<short>& building_clustering, int building_id, std::vector<cv::Mat_<int>>& clustering, int r, int c, int h, int cluster_id, std::vector<std::shared_ptr<VoxelNode>>& voxel_nodes);
-		static cv::Mat_<uchar> getSliceOfCluster(const cv::Mat_<int>& clustering, int cluster_id, int& min_x, int& min_y, int& max_x, int& max_y);
-		static Polygon getPolygonFromCluster(const cv::Mat_<int>& clustering, int cluster_id);
+		static void constructGraphs(const RunLabeling& labeling, const std::vector<int>& building_indices, std::vector<VoxelBuilding>& buildings, ThreadPool& pool);
+		static void extractContours(const RunLabeling& labeling, int h, const std::vector<int>& building_indices, const std::vector<int>& component_nodes, std::vector<VoxelBuilding>& buildings);
+		static void cleanupGraph(VoxelBuilding& building_voxels);
+		static Polygon getPolygonFromSlice(const cv::Mat_<uchar>& roi_slice, int x, int y);
 		static void convertCoordinatesOfPolygon(Polygon& polygon, int width, int height);
-		static std::vector<std::shared_ptr<BuildingLayer>> layeringBuilding(int building_id, const std::shared_ptr<VoxelNode>& voxel_node, float threshold, int min_num_slices_per_layer);
+		static std::vector<std::shared_ptr<BuildingLayer>> layeringBuilding(VoxelBuilding& building_voxels, int node, float threshold, int min_num_slices_per_layer);
+		static std::vector<int> childNodes(const VoxelBuilding& building_voxels, const std::vector<int>& nodes);
+		static double descendantIOU(VoxelBuilding& building_voxels, int node, int level, const std::vector<int>& descendants, float threshold);
+		static double calculateIOU(const VoxelBuilding& building_voxels, int node, const std::vector<int>& nodes2);
 		static void removeThinLayers(std::shared_ptr<BuildingLayer> layer, int min_num_slices_per_layer);
 	};
 
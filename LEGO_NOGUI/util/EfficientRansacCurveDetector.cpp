@@ -5,7 +5,8 @@ namespace util {
 
 	bool EfficientRansacCurveDetector::detect(const util::Polygon& polygon) {
 		// calculate bounding box
-		cv::Rect bbox = boundingBox(polygon.contour.getActualPoints().points);
+		std::vector<cv::Point2f> buffer;
+		cv::Rect bbox = boundingBox(polygon.contour.actualPoints(buffer));
 
 		std::vector<std::pair<cv::Point3f, cv::Point3f>> point_cloud;
 
@@ -47,6 +48,7 @@ namespace util {
 			}
 		}
 
+		pointcloud::shape::seedRandom(0);
 		for (int iter = 0; iter < 20; iter++) {
 			//if (pointcloud::shape::detectCurve(point_cloud, 0.000000001, std::max((int)(point_cloud.size() * 0.18), 10000), 5, 10, 0.9, 150, 400)) return true;
 			if (pointcloud::shape::detectCurve(point_cloud, 0.000000001, std::max((int)(point_cloud.size() * 0.09), std::min((int)point_cloud.size(), 200)), 5, 10, 0.9, 150, 400)) return true;
@@ -54,15 +56,20 @@ namespace util {
 		return false;
 	}
 
-	bool EfficientRansacCurveDetector::detect2(const std::vector<std::vector<util::Polygon>>& polygons) {
+	/**
+	 * Detect a curve in the stack of the raw footprints of a layer.
+	 * The contour points of each footprint are extracted once and replicated for all the slices it represents.
+	 */
+	bool EfficientRansacCurveDetector::detect2(const std::vector<util::RawFootprint>& raw_footprints) {
 		// calculate bounding box
 		int min_x = std::numeric_limits<int>::max();
 		int max_x = -std::numeric_limits<int>::max();
 		int min_y = std::numeric_limits<int>::max();;
 		int max_y = -std::numeric_limits<int>::max();
-		for (int z = 0; z < polygons.size(); z++) {
-			for (int i = 0; i < polygons[z].size(); i++) {
-				cv::Rect bbox = boundingBox(polygons[z][i].contour.getActualPoints().points);
+		std::vector<cv::Point2f> buffer;
+		for (auto& raw_footprint : raw_footprints) {
+			for (auto& polygon : raw_footprint.polygons) {
+				cv::Rect bbox = boundingBox(polygon->contour.actualPoints(buffer));
 				min_x = std::min(min_x, bbox.x);
 				max_x = std::max(max_x, bbox.x + bbox.width);
 				min_y = std::min(min_y, bbox.y);
@@ -72,10 +79,12 @@ namespace util {
 
 		std::vector<std::pair<cv::Point3f, cv::Point3f>> point_cloud;
 
-		for (int z = 0; z < polygons.size(); z++) {
-			for (int pi = 0; pi < polygons[z].size(); pi++) {
+		int z = 0;
+		for (auto& raw_footprint : raw_footprints) {
+			std::vector<std::pair<cv::Point2f, cv::Point2f>> slice_points;
+			for (auto& polygon : raw_footprint.polygons) {
 				cv::Mat_<uchar> image;
-				createImageFromPolygon(max_x - min_x, max_y - min_y, polygons[z][pi], cv::Point(-min_x, -min_y), image);
+				createImageFromPolygon(max_x - min_x, max_y - min_y, *polygon, cv::Point(-min_x, -min_y), image);
 
 				// extract contours
 				std::vector<std::vector<cv::Point>> contours;
@@ -92,28 +101,34 @@ namespace util {
 						cv::Point2f dir(contours[i][next].x - contours[i][prev].x, contours[i][next].y - contours[i][prev].y);
 						cv::Point2f normal(dir.y, -dir.x);
 
-						point_cloud.push_back({ cv::Point3f(contours[i][j].x, contours[i][j].y, z), cv::Point3f(normal.x, normal.y, 0) });
+						slice_points.push_back({ cv::Point2f(contours[i][j].x, contours[i][j].y), normal });
 					}
 
 					// obtain all the holes inside this contour
 					int hole_id = hierarchy[i][2];
 					while (hole_id != -1) {
-						Ring hole;
 						for (int j = 0; j < contours[hole_id].size(); j++) {
 							int prev = (j - 1 + contours[hole_id].size()) % contours[hole_id].size();
 							int next = (j + 1) % contours[hole_id].size();
 							cv::Point2f dir(contours[hole_id][next].x - contours[hole_id][prev].x, contours[hole_id][next].y - contours[hole_id][prev].y);
 							cv::Point2f normal(dir.y, -dir.x);
 
-							point_cloud.push_back({ cv::Point3f(contours[hole_id][j].x, contours[hole_id][j].y, z), cv::Point3f(normal.x, normal.y, 0) });
+							slice_points.push_back({ cv::Point2f(contours[hole_id][j].x, contours[hole_id][j].y), normal });
 						}
 
 						hole_id = hierarchy[hole_id][0];
 					}
 				}
 			}
+
+			for (int k = 0; k < raw_footprint.num_slices; k++, z++) {
+				for (auto& pt : slice_points) {
+					point_cloud.push_back({ cv::Point3f(pt.first.x, pt.first.y, z), cv::Point3f(pt.second.x, pt.second.y, 0) });
+				}
+			}
 		}
 
+		pointcloud::shape::seedRandom(0);
 		for (int iter = 0; iter < 10; iter++) {
 			if (pointcloud::shape::detectCurve(point_cloud, 0.000000001, std::max((int)(point_cloud.size() * 0.11), std::min((int)point_cloud.size(), 8000)), 5, 10, 0.9, 150, 400)) return true;
 			//if (pointcloud::shape::detectCurve(point_cloud, 0.000000001, std::max((int)(point_cloud.size() * 0.18), std::min((int)point_cloud.size(), 10000)), 10, 10, 0.9, 150, 400)) return true;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ContourUtils.h"
+#include "BuildingLayer.h"
 
 namespace util {
 
@@ -10,7 +11,7 @@ namespace util {
 
 	public:
 		static bool detect(const util::Polygon& polygons);
-		static bool detect2(const std::vector<std::vector<util::Polygon>>& polygons);
+		static bool detect2(const std::vector<util::RawFootprint>& raw_footprints);
 
 	};
 
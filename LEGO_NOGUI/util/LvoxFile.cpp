@@ -0,0 +1,255 @@
+#include "LvoxFile.h"
+#include <fstream>
+#include <cstring>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace util {
+
+	namespace lvox {
+
+		static_assert(sizeof(LvoxHeader) == 128, "The size of the lvox header must be 128 bytes.");
+
+		LvoxHeader::LvoxHeader() {
+			memset(this, 0, sizeof(LvoxHeader));
+			memcpy(magic, "LVOX", 4);
+			version = VERSION;
+			data_offset = sizeof(LvoxHeader);
+		}
+
+		/**
+		 * Return the number of bytes of one slice plane.
+		 */
+		size_t LvoxHeader::planeSize() const {
+			if (encoding == ENCODING_BITPACKED) {
+				return (size_t)(width + 63) / 64 * 8 * height;
+			}
+			else {
+				return (size_t)width * height;
+			}
+		}
+
+		/**
+		 * Write the occupancy volume as bit-packed planes.
+		 *
+		 * @param filename				output file name
+		 * @param volume				occupancy volume
+		 * @param voxel_value_threshold	the threshold that was used to create the volume (just for the record)
+		 * @param voxel_size			the size of a voxel in the world coordinates
+		 * @param offset_x				offset in the world coordinates
+		 * @param offset_y				offset in the world coordinates
+		 * @param offset_z				offset in the world coordinates
+		 * @param with_bounding_boxes	true if the bounding box of each slice is stored
+		 */
+		void LvoxWriter::write(const std::string& filename, const BinaryVolume& volume, int voxel_value_threshold, double voxel_size, double offset_x, double offset_y, double offset_z, bool with_bounding_boxes) {
+			LvoxHeader header;
+			header.width = volume.width;
+			header.height = volume.height;
+			header.depth = volume.depth;
+			header.encoding = LvoxHeader::ENCODING_BITPACKED;
+			header.voxel_value_threshold = voxel_value_threshold;
+			header.voxel_size = voxel_size;
+			header.offset_x = offset_x;
+			header.offset_y = offset_y;
+			header.offset_z = offset_z;
+
+			std::vector<const void*> planes(volume.depth);
+			std::vector<cv::Rect> bounding_boxes;
+			for (int z = 0; z < volume.depth; z++) {
+				planes[z] = volume.row(0, z);
+
+				if (with_bounding_boxes) {
+					int min_x = volume.width;
+					int min_y = volume.height;
+					int max_x = -1;
+					int max_y = -1;
+					for (int y = 0; y < volume.height; y++) {
+						const uint64_t* row = volume.row(y, z);
+						for (int w = 0; w < volume.words_per_row; w++) {
+							if (row[w] == 0) continue;
+							for (int x = w * 64; x < std::min(volume.width, w * 64 + 64); x++) {
+								if ((row[w] >> (x & 63)) & 1) {
+									min_x = std::min(min_x, x);
+									max_x = std::max(max_x, x);
+								}
+							}
+							min_y = std::min(min_y, y);
+							max_y = y;
+						}
+					}
+					bounding_boxes.push_back(max_x >= 0 ? cv::Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1) : cv::Rect());
+				}
+			}
+
+			write(filename, header, planes, bounding_boxes);
+		}
+
+		/**
+		 * Write the slice images as raw planes.
+		 *
+		 * @param filename				output file name
+		 * @param voxel_data			slice images
+		 * @param voxel_value_threshold	a voxel is occupied if its value is greater than this threshold
+		 * @param voxel_size			the size of a voxel in the world coordinates
+		 * @param offset_x				offset in the world coordinates
+		 * @param offset_y				offset in the world coordinates
+		 * @param offset_z				offset in the world coordinates
+		 * @param with_bounding_boxes	true if the bounding box of each slice is stored
+		 */
+		void LvoxWriter::write(const std::string& filename, const std::vector<cv::Mat_<uchar>>& voxel_data, int voxel_value_threshold, double voxel_size, double offset_x, double offset_y, double offset_z, bool with_bounding_boxes) {
+			if (voxel_data.size() == 0) throw "No slice to write.";
+
+			LvoxHeader header;
+			header.width = voxel_data[0].cols;
+			header.height = voxel_data[0].rows;
+			header.depth = voxel_data.size();
+			header.encoding = LvoxHeader::ENCODING_RAW;
+			header.voxel_value_threshold = voxel_value_threshold;
+			header.voxel_size = voxel_size;
+			header.offset_x = offset_x;
+			header.offset_y = offset_y;
+			header.offset_z = offset_z;
+
+			// make each slice continuous so that it can be written at once
+			std::vector<cv::Mat_<uchar>> continuous_slices(voxel_data.size());
+			std::vector<const void*> planes(voxel_data.size());
+			std::vector<cv::Rect> bounding_boxes;
+			for (int z = 0; z < voxel_data.size(); z++) {
+				if (voxel_data[z].size() != voxel_data[0].size()) throw "The slices have different sizes.";
+				continuous_slices[z] = voxel_data[z].isContinuous() ? voxel_data[z] : voxel_data[z].clone();
+				planes[z] = continuous_slices[z].data;
+
+				if (with_bounding_boxes) {
+					cv::Mat_<uchar> mask;
+					cv::compare(voxel_data[z], voxel_value_threshold, mask, cv::CMP_GT);
+					bounding_boxes.push_back(cv::boundingRect(mask));
+				}
+			}
+
+			write(filename, header, planes, bounding_boxes);
+		}
+
+		void LvoxWriter::write(const std::string& filename, LvoxHeader header, const std::vector<const void*>& planes, const std::vector<cv::Rect>& bounding_boxes) {
+			header.data_offset = sizeof(LvoxHeader);
+			if (bounding_boxes.size() > 0) {
+				header.flags |= LvoxHeader::FLAG_BOUNDING_BOXES;
+				header.bbox_offset = header.data_offset + header.planeSize() * header.depth;
+			}
+
+			std::ofstream out(filename, std::ios::binary);
+			if (!out.good()) throw "The lvox file could not be created.";
+
+			out.write((const char*)&header, sizeof(LvoxHeader));
+			for (int z = 0; z < planes.size(); z++) {
+				out.write((const char*)planes[z], header.planeSize());
+			}
+			for (int z = 0; z < bounding_boxes.size(); z++) {
+				int32_t bbox[4] = { bounding_boxes[z].x, bounding_boxes[z].y, bounding_boxes[z].width, bounding_boxes[z].height };
+				out.write((const char*)bbox, sizeof(bbox));
+			}
+
+			if (!out.good()) throw "The lvox file could not be written.";
+		}
+
+		/**
+		 * Map the .lvox file into memory.
+		 * The mapping is copy-on-write, so the file itself is never modified.
+		 */
+		LvoxVolume::LvoxVolume(const std::string& filename) {
+			try {
+				boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+				region = std::make_shared<boost::interprocess::mapped_region>(mapping, boost::interprocess::copy_on_write);
+			}
+			catch (...) {
+				throw "The lvox file could not be mapped.";
+			}
+
+			if (region->get_size() < sizeof(LvoxHeader)) throw "The lvox file is too small.";
+			memcpy(&header, region->get_address(), sizeof(LvoxHeader));
+			if (memcmp(header.magic, "LVOX", 4) != 0) throw "The file is not an lvox file.";
+			if (header.version != LvoxHeader::VERSION) throw "Unsupported lvox version.";
+			if (header.encoding != LvoxHeader::ENCODING_RAW && header.encoding != LvoxHeader::ENCODING_BITPACKED) throw "Unsupported lvox encoding.";
+			if (header.data_offset % 8 != 0 || header.data_offset + header.planeSize() * header.depth > region->get_size()) throw "The lvox file is truncated.";
+
+			if (header.flags & LvoxHeader::FLAG_BOUNDING_BOXES) {
+				if (header.bbox_offset + sizeof(int32_t) * 4 * header.depth > region->get_size()) throw "The lvox file is truncated.";
+				const uint8_t* p = (const uint8_t*)region->get_address() + header.bbox_offset;
+				bounding_boxes.resize(header.depth);
+				for (int z = 0; z < header.depth; z++) {
+					int32_t bbox[4];
+					memcpy(bbox, p + sizeof(bbox) * z, sizeof(bbox));
+					bounding_boxes[z] = cv::Rect(bbox[0], bbox[1], bbox[2], bbox[3]);
+				}
+			}
+		}
+
+		/**
+		 * Return the z-th slice as an image.
+		 * For the raw encoding, the image is a view of the mapped file and is valid only while this object is alive.
+		 * For the bit-packed encoding, the image is an unpacked copy whose occupied voxels are 255,
+		 * and the plane of an empty slice is not read if the bounding boxes are stored.
+		 */
+		cv::Mat_<uchar> LvoxVolume::slice(int z) const {
+			if (isBitPacked()) {
+				if (bounding_boxes.size() > 0 && bounding_boxes[z].area() == 0) return cv::Mat_<uchar>::zeros(header.height, header.width);
+
+				return volume().slice(z);
+			}
+			else {
+				return cv::Mat_<uchar>(header.height, header.width, plane(z), header.width);
+			}
+		}
+
+		/**
+		 * Return the slices as images.
+		 * For the raw encoding, the images are views of the mapped file and are valid only while this object is alive.
+		 * For the bit-packed encoding, the images are unpacked copies whose occupied voxels are 255.
+		 */
+		std::vector<cv::Mat_<uchar>> LvoxVolume::slices() const {
+			std::vector<cv::Mat_<uchar>> ans(header.depth);
+			if (isBitPacked()) {
+				BinaryVolume vol = volume();
+				for (int z = 0; z < header.depth; z++) {
+					ans[z] = vol.slice(z);
+				}
+			}
+			else {
+				for (int z = 0; z < header.depth; z++) {
+					ans[z] = slice(z);
+				}
+			}
+			return ans;
+		}
+
+		/**
+		 * Return the occupancy volume.
+		 * For the bit-packed encoding, the volume directly uses the mapped file and keeps the mapping alive.
+		 * For the raw encoding, the slices are thresholded into a new volume. If the bounding boxes are stored,
+		 * only the voxels inside them are read, and the planes of the empty slices are skipped.
+		 */
+		BinaryVolume LvoxVolume::volume() const {
+			if (isBitPacked()) {
+				std::shared_ptr<uint64_t> words(region, (uint64_t*)plane(0));
+				return BinaryVolume(header.width, header.height, header.depth, words);
+			}
+			else {
+				BinaryVolume ans(header.width, header.height, header.depth);
+				for (int z = 0; z < header.depth; z++) {
+					if (bounding_boxes.size() > 0) {
+						if (bounding_boxes[z].area() > 0) ans.setSlice(z, slice(z), header.voxel_value_threshold, bounding_boxes[z]);
+					}
+					else {
+						ans.setSlice(z, slice(z), header.voxel_value_threshold);
+					}
+				}
+				return ans;
+			}
+		}
+
+		uint8_t* LvoxVolume::plane(int z) const {
+			return (uint8_t*)region->get_address() + header.data_offset + header.planeSize() * z;
+		}
+
+	}
+
+}
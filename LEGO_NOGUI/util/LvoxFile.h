@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include "BinaryVolume.h"
+
+namespace boost {
+	namespace interprocess {
+		class mapped_region;
+	}
+}
+
+namespace util {
+
+	namespace lvox {
+
+		/**
+		 * Header of the .lvox volume file.
+		 * The file consists of this header, the slice planes from bottom to top, and an optional table of
+		 * the bounding box of the occupied voxels in each slice (int32 x, y, width, height; all 0 for an empty slice).
+		 * A raw plane stores 1 byte per voxel, and a bit-packed plane uses the same layout as BinaryVolume.
+		 * All the values are little endian.
+		 */
+		class LvoxHeader {
+		public:
+			enum { ENCODING_RAW = 0, ENCODING_BITPACKED };
+			enum { FLAG_BOUNDING_BOXES = 1 };
+			static const uint32_t VERSION = 1;
+
+			char magic[4];
+			uint32_t version;
+			uint32_t width;
+			uint32_t height;
+			uint32_t depth;
+			uint32_t encoding;
+			int32_t voxel_value_threshold;	// a voxel is occupied if its value is greater than this
+			uint32_t flags;
+			double voxel_size;
+			double offset_x;
+			double offset_y;
+			double offset_z;
+			uint64_t data_offset;
+			uint64_t bbox_offset;
+			uint8_t reserved[48];
+
+		public:
+			LvoxHeader();
+			size_t planeSize() const;
+		};
+
+		class LvoxWriter {
+		protected:
+			LvoxWriter() {}
+
+		public:
+			static void write(const std::string& filename, const BinaryVolume& volume, int voxel_value_threshold, double voxel_size, double offset_x, double offset_y, double offset_z, bool with_bounding_boxes = true);
+			static void write(const std::string& filename, const std::vector<cv::Mat_<uchar>>& voxel_data, int voxel_value_threshold, double voxel_size, double offset_x, double offset_y, double offset_z, bool with_bounding_boxes = true);
+
+		private:
+			static void write(const std::string& filename, LvoxHeader header, const std::vector<const void*>& planes, const std::vector<cv::Rect>& bounding_boxes);
+		};
+
+		/**
+		 * A .lvox file mapped into memory.
+		 * The slices are not copied at loading time; the pages are read from the file when they are first accessed.
+		 * Only the bit-packed encoding is zero-copy as a BinaryVolume. A raw file is zero-copy as slice images,
+		 * but volume() thresholds it into a new BinaryVolume, reading only the bounding box of each slice if stored.
+		 */
+		class LvoxVolume {
+		public:
+			LvoxHeader header;
+			std::vector<cv::Rect> bounding_boxes;
+
+		private:
+			std::shared_ptr<boost::interprocess::mapped_region> region;
+
+		public:
+			LvoxVolume(const std::string& filename);
+
+			bool isBitPacked() const { return header.encoding == LvoxHeader::ENCODING_BITPACKED; }
+			cv::Mat_<uchar> slice(int z) const;
+			std::vector<cv::Mat_<uchar>> slices() const;
+			BinaryVolume volume() const;
+
+		private:
+			uint8_t* plane(int z) const;
+		};
+
+	}
+
+}
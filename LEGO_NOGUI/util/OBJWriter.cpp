@@ -215,8 +215,8 @@ namespace util {
 
 			for (auto& voxel_building : voxel_buildings) {
 				for (int z = 0; z < voxel_building.node_stack.size(); z++) {
-					for (auto voxel_node : voxel_building.node_stack[z]) {
-						writeVoxelNode(voxel_node, scale, cv::Point3f(1, 1, 1), faces);
+					for (int node : voxel_building.node_stack[z]) {
+						writeVoxelNode(voxel_building.nodes[node], scale, cv::Point3f(1, 1, 1), faces);
 					}
 				}
 			}
@@ -471,14 +471,14 @@ namespace util {
 			return ans;
 		}
 
-		void OBJWriter::writeVoxelNode(std::shared_ptr<VoxelNode> voxel_node, double scale, const cv::Point3f& color, std::vector<Face>& faces) {
+		void OBJWriter::writeVoxelNode(const VoxelNode& voxel_node, double scale, const cv::Point3f& color, std::vector<Face>& faces) {
 			double height = 1;
-			double z = voxel_node->height;
+			double z = voxel_node.height;
 
-			Ring contour = voxel_node->contour.contour.getActualPoints();
-			std::vector<Ring> holes(voxel_node->contour.holes.size());
-			for (int i = 0; i < voxel_node->contour.holes.size(); i++) {
-				holes[i] = voxel_node->contour.holes[i].getActualPoints();
+			Ring contour = voxel_node.contour->contour.getActualPoints();
+			std::vector<Ring> holes(voxel_node.contour->holes.size());
+			for (int i = 0; i < voxel_node.contour->holes.size(); i++) {
+				holes[i] = voxel_node.contour->holes[i].getActualPoints();
 			}
 
 			std::vector<std::vector<cv::Point2f>> polygons;
@@ -506,7 +506,7 @@ namespace util {
 			}
 
 			// side faces
-			util::Ring polygon = voxel_node->contour.contour.getActualPoints();
+			util::Ring polygon = voxel_node.contour->contour.getActualPoints();
 			polygon.counterClockwise();
 
 			for (int i = 0; i < polygon.size(); i++) {
@@ -529,7 +529,7 @@ namespace util {
 			}
 					
 			// side faces of holes
-			for (auto& bh : voxel_node->contour.holes) {
+			for (auto& bh : voxel_node.contour->holes) {
 				util::Ring hole = bh.getActualPoints();
 				hole.clockwise();
 
@@ -69,7 +69,7 @@ namespace util {
 			static void createFace(const std::vector<cv::Point2f>& coords, double z, double h, float floor_tile_width, float floor_tile_height, const cv::Point3f& color, const std::string& facade_texture, std::vector<Face>& faces);
 			static double dotProductBetweenThreePoints(const cv::Point2f& a, const cv::Point2f& b, const cv::Point2f& c);
 			static double getLength(const std::vector<cv::Point2f>& points);
-			static void writeVoxelNode(std::shared_ptr<VoxelNode> voxel_node, double scale, const cv::Point3f& color, std::vector<Face>& faces);
+			static void writeVoxelNode(const VoxelNode& voxel_node, double scale, const cv::Point3f& color, std::vector<Face>& faces);
 		};
 
 	}
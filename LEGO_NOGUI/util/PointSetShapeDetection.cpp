@@ -7,6 +7,15 @@ namespace util {
 
 		namespace shape {
 
+			/**
+			 * Reset the random generator that Efficient RANSAC of the calling thread samples the points with.
+			 * CGAL keeps one generator per thread, so the detection is reproducible only if it is seeded
+			 * before each input regardless of which thread has processed which input so far.
+			 */
+			void seedRandom(unsigned int seed) {
+				CGAL::get_default_random() = CGAL::Random(seed);
+			}
+
 			bool detectCurve(std::vector<std::pair<cv::Point3f, cv::Point3f>>& point_cloud, double probability, int min_points, double epsilon, double cluster_epsilon, double normal_threshold, double min_radius, double max_radius) {
 				// Points with normals.
 				Pwn_vector points;
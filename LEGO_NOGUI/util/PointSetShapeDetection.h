@@ -12,6 +12,7 @@
 #include <CGAL/Polygon_traits_2.h>
 #include <CGAL/Polygon_2.h>
 #include <CGAL/Polygon_with_holes_2.h>
+#include <CGAL/Random.h>
 #include <iostream>
 #include <fstream>
 #include <list>
@@ -50,6 +51,7 @@ namespace util {
 
 			typedef CGAL::Point_set_3<Kernel::Point_3> Point_set;
 
+			void seedRandom(unsigned int seed);
 			bool detectCurve(std::vector<std::pair<cv::Point3f, cv::Point3f>>& point_cloud, double probability, int min_points, double epsilon, double cluster_epsilon, double normal_threshold, double min_radius, double max_radius);
 
 		}
@@ -0,0 +1,189 @@
+#include "RunLabeling.h"
+#include <algorithm>
+
+namespace util {
+
+	/**
+	 * Sort the overlaps [first, end) by (lower, upper) and merge the duplicates by summing their voxel counts.
+	 * This turns the overlaps that are recorded per run or per voxel into the histogram of the label pairs.
+	 */
+	void ComponentOverlap::accumulate(std::vector<ComponentOverlap>& overlaps, int first) {
+		std::sort(overlaps.begin() + first, overlaps.end(), [](const ComponentOverlap& a, const ComponentOverlap& b) {
+			return a.lower < b.lower || (a.lower == b.lower && a.upper < b.upper);
+		});
+
+		int num_overlaps = first;
+		for (int i = first; i < overlaps.size(); i++) {
+			if (num_overlaps > first && overlaps[num_overlaps - 1].lower == overlaps[i].lower && overlaps[num_overlaps - 1].upper == overlaps[i].upper) {
+				overlaps[num_overlaps - 1].voxel_count += overlaps[i].voxel_count;
+			}
+			else {
+				overlaps[num_overlaps++] = overlaps[i];
+			}
+		}
+		overlaps.resize(num_overlaps);
+	}
+
+	/**
+	 * Label the occupancy volume.
+	 * Each slice is encoded into runs, the overlapping runs of adjacent rows are merged into SliceComponents,
+	 * and the overlapping runs of the same row in adjacent slices merge the SliceComponents into buildings.
+	 * The voxel counts of both and the bounding boxes of the SliceComponents are accumulated from the runs in the same pass.
+	 */
+	RunLabeling::RunLabeling(const BinaryVolume& volume) : width(volume.width), height(volume.height), depth(volume.depth) {
+		std::vector<int> component_parents;		// union-find of the components for the buildings
+		auto find = [&component_parents](int index) {
+			while (component_parents[index] != index) {
+				component_parents[index] = component_parents[component_parents[index]];
+				index = component_parents[index];
+			}
+			return index;
+		};
+
+		std::vector<int> row_offsets;
+		std::vector<int> prev_row_offsets;
+		std::vector<int> run_parents;			// union-find of the runs in the current slice
+		slice_run_offsets.push_back(0);
+		slice_component_offsets.push_back(0);
+		for (int z = 0; z < depth; z++) {
+			int first_run = runs.size();
+			extractRuns(volume, z, runs, row_offsets);
+			int num_runs = runs.size() - first_run;
+
+			// merge the runs that overlap with the runs in the previous row
+			run_parents.resize(num_runs);
+			for (int i = 0; i < num_runs; i++) run_parents[i] = i;
+			auto find_run = [&run_parents](int index) {
+				while (run_parents[index] != index) {
+					run_parents[index] = run_parents[run_parents[index]];
+					index = run_parents[index];
+				}
+				return index;
+			};
+			for (int y = 1; y < height; y++) {
+				int i = row_offsets[y - 1];
+				int j = row_offsets[y];
+				while (i < row_offsets[y] && j < row_offsets[y + 1]) {
+					if (runs[i].x0 < runs[j].x1 && runs[j].x0 < runs[i].x1) {
+						int a = find_run(i - first_run);
+						int b = find_run(j - first_run);
+						if (a != b) run_parents[std::max(a, b)] = std::min(a, b);
+					}
+					if (runs[i].x1 < runs[j].x1) i++;
+					else j++;
+				}
+			}
+
+			// Number the components in the order of their first runs.
+			// The root of each run set is its first run, so the component is created when the root is visited.
+			for (int i = 0; i < num_runs; i++) {
+				VoxelRun& run = runs[first_run + i];
+				int root = find_run(i);
+				if (root == i) {
+					run.component = components.size();
+					components.push_back(SliceComponent(z));
+					components.back().bbox = cv::Rect(run.x0, run.y, run.length(), 1);
+					component_parents.push_back(run.component);
+				}
+				else {
+					run.component = runs[first_run + root].component;
+
+					// the runs come in (y, x) order, so only the left, the right, and the bottom sides can grow
+					cv::Rect& bbox = components[run.component].bbox;
+					int x1 = std::max(bbox.x + bbox.width, run.x1);
+					bbox.x = std::min(bbox.x, run.x0);
+					bbox.width = x1 - bbox.x;
+					bbox.height = run.y - bbox.y + 1;
+				}
+				components[run.component].voxel_count += run.length();
+			}
+
+			// merge the components that overlap with the components in the previous slice
+			if (z > 0) {
+				int first_overlap = overlaps.size();
+				for (int y = 0; y < height; y++) {
+					int i = prev_row_offsets[y];
+					int j = row_offsets[y];
+					while (i < prev_row_offsets[y + 1] && j < row_offsets[y + 1]) {
+						if (runs[i].x0 < runs[j].x1 && runs[j].x0 < runs[i].x1) {
+							int lower = runs[i].component;
+							int upper = runs[j].component;
+							int voxel_count = std::min(runs[i].x1, runs[j].x1) - std::max(runs[i].x0, runs[j].x0);
+							if (overlaps.size() > first_overlap && overlaps.back().lower == lower && overlaps.back().upper == upper) {
+								overlaps.back().voxel_count += voxel_count;
+							}
+							else {
+								overlaps.push_back(ComponentOverlap(lower, upper, voxel_count));
+							}
+
+							int a = find(lower);
+							int b = find(upper);
+							if (a != b) component_parents[std::max(a, b)] = std::min(a, b);
+						}
+						if (runs[i].x1 < runs[j].x1) i++;
+						else j++;
+					}
+				}
+				ComponentOverlap::accumulate(overlaps, first_overlap);
+			}
+
+			slice_run_offsets.push_back(runs.size());
+			slice_component_offsets.push_back(components.size());
+			std::swap(row_offsets, prev_row_offsets);
+		}
+
+		// Number the buildings in the order of their first components.
+		// The root of each component set is its first component, so the building is created when the root is visited.
+		for (int i = 0; i < components.size(); i++) {
+			int root = find(i);
+			if (root == i) {
+				components[i].building = building_voxel_counts.size();
+				building_voxel_counts.push_back(0);
+			}
+			else {
+				components[i].building = components[root].building;
+			}
+			building_voxel_counts[components[i].building] += components[i].voxel_count;
+		}
+	}
+
+	/**
+	 * Append the runs of the z-th slice.
+	 * The runs of row y are [row_offsets[y], row_offsets[y + 1]) in the array.
+	 * The bits are scanned word by word, so the empty parts of the slice cost almost nothing.
+	 */
+	void RunLabeling::extractRuns(const BinaryVolume& volume, int z, std::vector<VoxelRun>& runs, std::vector<int>& row_offsets) {
+		row_offsets.resize(volume.height + 1);
+		for (int y = 0; y < volume.height; y++) {
+			row_offsets[y] = runs.size();
+
+			const uint64_t* row = volume.row(y, z);
+			int x0 = -1;	// the start of the run that may continue to the next word
+			int x1 = -1;
+			for (int w = 0; w < volume.words_per_row; w++) {
+				uint64_t word = row[w];
+				while (word != 0) {
+					int start = countTrailingZeros(word);
+					uint64_t ones = ~(word >> start);
+					int length = ones == 0 ? 64 - start : std::min(64 - start, countTrailingZeros(ones));
+
+					if (x1 == w * 64 + start) {
+						// the run continues from the previous word
+						x1 += length;
+					}
+					else {
+						if (x0 >= 0) runs.push_back(VoxelRun(y, x0, x1));
+						x0 = w * 64 + start;
+						x1 = x0 + length;
+					}
+
+					if (start + length >= 64) break;
+					word &= ~0ULL << (start + length);
+				}
+			}
+			if (x0 >= 0) runs.push_back(VoxelRun(y, x0, x1));
+		}
+		row_offsets[volume.height] = runs.size();
+	}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "BinaryVolume.h"
+
+namespace util {
+
+	/**
+	 * A horizontal run of occupied voxels [x0, x1) in row y.
+	 */
+	class VoxelRun {
+	public:
+		int y;
+		int x0;
+		int x1;
+		int component;	// index of the connected component in the slice
+
+	public:
+		VoxelRun() {}
+		VoxelRun(int y, int x0, int x1) : y(y), x0(x0), x1(x1), component(-1) {}
+		int length() const { return x1 - x0; }
+	};
+
+	/**
+	 * A 4-connected component of the occupied voxels in a slice.
+	 */
+	class SliceComponent {
+	public:
+		int z;
+		int building;	// index of the 3D connected component in this labeling (not a building id)
+		int voxel_count;
+		cv::Rect bbox;	// bounding box of the voxels in the slice
+
+	public:
+		SliceComponent() {}
+		SliceComponent(int z) : z(z), building(-1), voxel_count(0) {}
+	};
+
+	/**
+	 * A pair of the overlapping components in adjacent slices and the number of the voxels they share in (x, y).
+	 */
+	class ComponentOverlap {
+	public:
+		int lower;
+		int upper;
+		int voxel_count;
+
+	public:
+		ComponentOverlap() {}
+		ComponentOverlap(int lower, int upper, int voxel_count) : lower(lower), upper(upper), voxel_count(voxel_count) {}
+
+		static void accumulate(std::vector<ComponentOverlap>& overlaps, int first);
+	};
+
+	/**
+	 * Connected component labeling of the occupancy volume based on the runs of each row.
+	 * The runs are merged within each slice into SliceComponents, and the SliceComponents that
+	 * overlap between adjacent slices are merged into 3D components (buildings).
+	 * Both kinds of components are numbered in the order of their first voxels in (z, y, x) order.
+	 */
+	class RunLabeling {
+	public:
+		int width;
+		int height;
+		int depth;
+		std::vector<VoxelRun> runs;							// ordered by (z, y, x0)
+		std::vector<int> slice_run_offsets;					// the runs of slice z are [slice_run_offsets[z], slice_run_offsets[z + 1])
+		std::vector<SliceComponent> components;				// ordered by (z, first voxel)
+		std::vector<int> slice_component_offsets;			// the components of slice z are [slice_component_offsets[z], slice_component_offsets[z + 1])
+		std::vector<ComponentOverlap> overlaps;				// overlapping components ordered by (lower, upper) without duplicates
+		std::vector<long long> building_voxel_counts;		// the number of voxels of each building
+
+	public:
+		RunLabeling(const BinaryVolume& volume);
+
+		int numBuildings() const { return building_voxel_counts.size(); }
+
+	private:
+		static void extractRuns(const BinaryVolume& volume, int z, std::vector<VoxelRun>& runs, std::vector<int>& row_offsets);
+	};
+
+}
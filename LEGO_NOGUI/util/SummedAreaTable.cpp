@@ -0,0 +1,123 @@
+#include "SummedAreaTable.h"
+#include "ContourUtils.h"
+
+namespace util {
+
+	/**
+	 * Build the table of the image.
+	 *
+	 * @param img		binary image
+	 * @param origin	coordinates of the top left pixel of the image in the coordinate system of the contours
+	 */
+	SummedAreaTable::SummedAreaTable(const cv::Mat_<uchar>& img, const cv::Point& origin) : img(img), origin(origin), count(0) {
+		sums = cv::Mat_<int>::zeros(img.rows + 1, img.cols + 1);
+		for (int r = 0; r < img.rows; r++) {
+			int row_sum = 0;
+			for (int c = 0; c < img.cols; c++) {
+				if (img(r, c) > 0) row_sum++;
+				sums(r + 1, c + 1) = sums(r, c + 1) + row_sum;
+			}
+			count += row_sum;
+		}
+	}
+
+	/**
+	 * Return the table value at (x, y) of the image, where the coordinates outside the image are clamped.
+	 */
+	int SummedAreaTable::at(int x, int y) const {
+		x = std::min(std::max(x, 0), img.cols);
+		y = std::min(std::max(y, 0), img.rows);
+		return sums(y, x);
+	}
+
+	/**
+	 * Return the number of the non-zero pixels in [x0, x1) x [y0, y1).
+	 */
+	long long SummedAreaTable::sum(int x0, int y0, int x1, int y1) const {
+		x0 -= origin.x;
+		x1 -= origin.x;
+		y0 -= origin.y;
+		y1 -= origin.y;
+		return (long long)at(x1, y1) - at(x0, y1) - at(x1, y0) + at(x0, y0);
+	}
+
+	/**
+	 * Calculate the number of the pixels of the image that the contour covers and how many of them are non-zero.
+	 * A downward vertical edge adds the pixels on its left in its rows and an upward one subtracts them,
+	 * which gives the pixels inside the contour for either orientation as long as the contour does not cross itself.
+	 * Touching edges and zero-width parts, which the moves of the vertices may cause, are counted correctly.
+	 *
+	 * @param contour		rectilinear contour
+	 * @param area			[OUT] the number of the pixels inside the contour
+	 * @param intersection	[OUT] the number of the non-zero pixels inside the contour
+	 * @return				false if the contour has an edge that is not axis aligned
+	 */
+	bool SummedAreaTable::measure(const std::vector<cv::Point>& contour, long long& area, long long& intersection) const {
+		area = 0;
+		intersection = 0;
+		for (int i = 0; i < contour.size(); i++) {
+			const cv::Point& p1 = contour[i];
+			const cv::Point& p2 = contour[(i + 1) % contour.size()];
+			if (p1.x != p2.x) {
+				if (p1.y != p2.y) return false;
+				continue;
+			}
+			if (p1.y == p2.y) continue;
+
+			int sign = p2.y > p1.y ? 1 : -1;
+			int x = p1.x - origin.x;
+			int y1 = std::min(p1.y, p2.y) - origin.y;
+			int y2 = std::max(p1.y, p2.y) - origin.y;
+
+			// only the pixels of the image are counted
+			int clamped_x = std::min(std::max(x, 0), img.cols);
+			int clamped_y1 = std::min(std::max(y1, 0), img.rows);
+			int clamped_y2 = std::min(std::max(y2, 0), img.rows);
+			area += (long long)sign * (clamped_y2 - clamped_y1) * clamped_x;
+			intersection += sign * (at(x, y2) - at(x, y1));
+		}
+
+		if (orientation(contour) < 0) {
+			area = -area;
+			intersection = -intersection;
+		}
+
+		return true;
+	}
+
+	/**
+	 * Return 1 if the downward vertical edges of the rectilinear contour are on the right of its inside,
+	 * i.e., the contour is clockwise in the image coordinates, and -1 otherwise.
+	 */
+	int SummedAreaTable::orientation(const std::vector<cv::Point>& contour) {
+		long long signed_area = 0;
+		for (int i = 0; i < contour.size(); i++) {
+			const cv::Point& p1 = contour[i];
+			const cv::Point& p2 = contour[(i + 1) % contour.size()];
+			if (p1.x == p2.x) signed_area += (long long)(p2.y - p1.y) * p1.x;
+		}
+		return signed_area < 0 ? -1 : 1;
+	}
+
+	/**
+	 * Calculate the IOU between the image and the contour rasterized by createImageFromContour() in the image.
+	 * The table is used for a rectilinear contour, which must not cross itself, and the contour is rasterized otherwise.
+	 */
+	double SummedAreaTable::calculateIOU(const std::vector<cv::Point>& contour) const {
+		long long area;
+		long long intersection;
+		if (!measure(contour, area, intersection)) return rasterIOU(contour);
+
+		return (double)intersection / (count + area - intersection);
+	}
+
+	/**
+	 * Calculate the IOU between the image and the contour by rasterizing the contour.
+	 */
+	double SummedAreaTable::rasterIOU(const std::vector<cv::Point>& contour) const {
+		cv::Mat_<uchar> img2;
+		util::createImageFromContour(img.cols, img.rows, contour, -origin, img2);
+		return util::calculateIOU(img, img2);
+	}
+
+}
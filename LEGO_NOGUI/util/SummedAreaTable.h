@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+namespace util {
+
+	/**
+	 * Summed-area table of a binary image for scoring rectilinear contours against it.
+	 * createImageFromContour() rasterizes a simple rectilinear contour with integer vertices into exactly the pixels
+	 * whose centers are inside it. The number of those pixels and of the ones shared with the image are then sums of
+	 * the table values at the end points of its vertical edges, which costs O(#vertices) instead of O(#pixels).
+	 * The contours are in the coordinates where the top left pixel of the image is at "origin".
+	 */
+	class SummedAreaTable {
+	public:
+		cv::Mat_<uchar> img;
+		cv::Point origin;
+		cv::Mat_<int> sums;		// sums(y, x) is the number of the non-zero pixels in [0, x) x [0, y) of the image
+		long long count;		// the number of the non-zero pixels of the image
+
+	public:
+		SummedAreaTable(const cv::Mat_<uchar>& img, const cv::Point& origin);
+
+		long long sum(int x0, int y0, int x1, int y1) const;
+		bool measure(const std::vector<cv::Point>& contour, long long& area, long long& intersection) const;
+		double calculateIOU(const std::vector<cv::Point>& contour) const;
+		double rasterIOU(const std::vector<cv::Point>& contour) const;
+		static int orientation(const std::vector<cv::Point>& contour);
+
+	private:
+		int at(int x, int y) const;
+	};
+
+}
@@ -0,0 +1,119 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <exception>
+
+namespace util {
+
+	/**
+	 * Create a thread pool.
+	 *
+	 * @param num_threads	the total number of threads including the calling thread (0 - use all the hardware threads)
+	 */
+	ThreadPool::ThreadPool(int num_threads) : stopping(false) {
+		num_threads = resolveNumThreads(num_threads);
+		for (int i = 0; i < num_threads - 1; i++) {
+			workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		condition.notify_all();
+		for (int i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+
+	/**
+	 * Return the actual number of threads to use for the specified config value.
+	 * A non-positive value means the number of hardware threads.
+	 */
+	int ThreadPool::resolveNumThreads(int num_threads) {
+		if (num_threads <= 0) {
+			num_threads = std::thread::hardware_concurrency();
+		}
+		return std::max(1, num_threads);
+	}
+
+	/**
+	 * Call func(i) for i = 0, ..., num_items - 1 using all the threads of the pool, and return when all the calls are done.
+	 * If some calls throw, the first exception is rethrown after all the other calls are finished.
+	 */
+	void ThreadPool::parallelFor(int num_items, const std::function<void(int)>& func) {
+		if (num_items <= 0) return;
+
+		if (workers.empty() || num_items == 1) {
+			for (int i = 0; i < num_items; i++) {
+				func(i);
+			}
+			return;
+		}
+
+		struct Job {
+			std::atomic<int> next_index;
+			int num_done;
+			std::exception_ptr exception;
+			std::mutex mutex;
+			std::condition_variable finished;
+		};
+		std::shared_ptr<Job> job = std::make_shared<Job>();
+		job->next_index = 0;
+		job->num_done = 0;
+
+		// Each runner keeps taking the next index until the range is exhausted.
+		// The job is captured by value so that a runner which starts after everything is done still finds it alive.
+		std::function<void()> runner = [job, num_items, &func]() {
+			while (true) {
+				int i = job->next_index++;
+				if (i >= num_items) break;
+
+				try {
+					func(i);
+				}
+				catch (...) {
+					std::unique_lock<std::mutex> lock(job->mutex);
+					if (!job->exception) job->exception = std::current_exception();
+				}
+
+				std::unique_lock<std::mutex> lock(job->mutex);
+				if (++job->num_done == num_items) job->finished.notify_all();
+			}
+		};
+
+		int num_runners = std::min((int)workers.size(), num_items - 1);
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			for (int i = 0; i < num_runners; i++) {
+				tasks.push(runner);
+			}
+		}
+		condition.notify_all();
+
+		// the calling thread also works on the items
+		runner();
+
+		std::unique_lock<std::mutex> lock(job->mutex);
+		job->finished.wait(lock, [&job, num_items]() { return job->num_done == num_items; });
+		if (job->exception) std::rethrow_exception(job->exception);
+	}
+
+	void ThreadPool::workerLoop() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty()) return;
+				task = std::move(tasks.front());
+				tasks.pop();
+			}
+			task();
+		}
+	}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace util {
+
+	/**
+	 * A bounded pool of worker threads.
+	 * The work is submitted as an index range by parallelFor(), and the indices are handed out
+	 * one by one to the workers so that slow items do not stall the others.
+	 * The calling thread also processes the indices while waiting, which makes nested calls safe.
+	 */
+	class ThreadPool {
+	private:
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool stopping;
+
+	public:
+		ThreadPool(int num_threads = 0);
+		~ThreadPool();
+
+		int size() const { return (int)workers.size() + 1; }
+		void parallelFor(int num_items, const std::function<void(int)>& func);
+
+		static int resolveNumThreads(int num_threads);
+
+	private:
+		ThreadPool(const ThreadPool&);
+		ThreadPool& operator=(const ThreadPool&);
+		void workerLoop();
+	};
+
+}
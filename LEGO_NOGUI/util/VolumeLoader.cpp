@@ -0,0 +1,102 @@
+#include "VolumeLoader.h"
+#include <iostream>
+#include "ThreadPool.h"
+
+namespace util {
+
+	VolumeLoader::VolumeLoader() {
+	}
+
+	/**
+	 * Decode the slice images as grayscale images.
+	 * All the slices are decoded even if some of them fail, and every failure is reported to stderr
+	 * before an exception is thrown, so that the user can fix all the broken files at once.
+	 *
+	 * @param filenames		the slice image files in the bottom-to-top order
+	 * @param num_threads	the number of decoding threads (0 - use all the hardware threads)
+	 * @return				the slices of the volume
+	 */
+	std::vector<cv::Mat_<uchar>> VolumeLoader::load(const std::vector<std::string>& filenames, int num_threads) {
+		if (filenames.size() == 0) throw "No slice image was found.";
+
+		std::vector<cv::Mat_<uchar>> voxel_data(filenames.size());
+		ThreadPool pool(std::min(ThreadPool::resolveNumThreads(num_threads), (int)filenames.size()));
+		pool.parallelFor(filenames.size(), [&](int i) {
+			voxel_data[i] = cv::imread(filenames[i], cv::IMREAD_GRAYSCALE);
+		});
+
+		std::vector<cv::Size> sizes(voxel_data.size());
+		for (int i = 0; i < voxel_data.size(); i++) {
+			sizes[i] = voxel_data[i].size();
+		}
+		reportErrors(filenames, sizes);
+
+		return voxel_data;
+	}
+
+	/**
+	 * Decode one slice image as a grayscale image.
+	 * The failure is reported to stderr before an exception is thrown.
+	 */
+	cv::Mat_<uchar> VolumeLoader::loadSlice(const std::string& filename) {
+		cv::Mat_<uchar> slice = cv::imread(filename, cv::IMREAD_GRAYSCALE);
+		if (slice.empty()) {
+			std::cerr << "Slice could not be decoded: " << filename << std::endl;
+			throw "Failed to load the slice images.";
+		}
+		return slice;
+	}
+
+	/**
+	 * Decode the slice images directly into a bit-packed occupancy volume.
+	 * Only one decoded image per thread is alive at a time, so the whole volume is never stored in 1 byte per voxel.
+	 *
+	 * @param filenames				the slice image files in the bottom-to-top order
+	 * @param voxel_value_threshold	a voxel is occupied if its value is greater than this threshold
+	 * @param num_threads			the number of decoding threads (0 - use all the hardware threads)
+	 * @return						the occupancy volume
+	 */
+	BinaryVolume VolumeLoader::loadBinary(const std::vector<std::string>& filenames, int voxel_value_threshold, int num_threads) {
+		if (filenames.size() == 0) throw "No slice image was found.";
+
+		// the first slice determines the size of the volume
+		cv::Mat_<uchar> first_slice = cv::imread(filenames[0], cv::IMREAD_GRAYSCALE);
+		if (first_slice.empty()) {
+			std::cerr << "Slice 0 could not be decoded: " << filenames[0] << std::endl;
+			throw "Failed to load the slice images.";
+		}
+
+		BinaryVolume volume(first_slice.cols, first_slice.rows, filenames.size());
+		std::vector<cv::Size> sizes(filenames.size());
+		ThreadPool pool(std::min(ThreadPool::resolveNumThreads(num_threads), (int)filenames.size()));
+		pool.parallelFor(filenames.size(), [&](int i) {
+			cv::Mat_<uchar> slice = i == 0 ? first_slice : cv::imread(filenames[i], cv::IMREAD_GRAYSCALE);
+			sizes[i] = slice.size();
+			if (slice.size() == volume.sliceSize()) {
+				volume.setSlice(i, slice, voxel_value_threshold);
+			}
+		});
+		reportErrors(filenames, sizes);
+
+		return volume;
+	}
+
+	/**
+	 * Report every slice which could not be decoded or has a different size from the first slice, and throw an exception if any.
+	 */
+	void VolumeLoader::reportErrors(const std::vector<std::string>& filenames, const std::vector<cv::Size>& sizes) {
+		int num_errors = 0;
+		for (int i = 0; i < sizes.size(); i++) {
+			if (sizes[i].area() == 0) {
+				std::cerr << "Slice " << i << " could not be decoded: " << filenames[i] << std::endl;
+				num_errors++;
+			}
+			else if (sizes[i] != sizes[0] && sizes[0].area() > 0) {
+				std::cerr << "Slice " << i << " has a different size (" << sizes[i].width << "x" << sizes[i].height << ") from the first slice: " << filenames[i] << std::endl;
+				num_errors++;
+			}
+		}
+		if (num_errors > 0) throw "Failed to load the slice images.";
+	}
+
+}
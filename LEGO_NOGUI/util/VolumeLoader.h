@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <opencv2/opencv.hpp>
+#include "BinaryVolume.h"
+
+namespace util {
+
+	/**
+	 * Load the slice images of a voxel volume.
+	 * The slices are decoded concurrently, but the i-th slice always comes from the i-th file.
+	 */
+	class VolumeLoader {
+	protected:
+		VolumeLoader();
+
+	public:
+		static std::vector<cv::Mat_<uchar>> load(const std::vector<std::string>& filenames, int num_threads = 0);
+		static cv::Mat_<uchar> loadSlice(const std::string& filename);
+		static BinaryVolume loadBinary(const std::vector<std::string>& filenames, int voxel_value_threshold = 128, int num_threads = 0);
+
+	private:
+		static void reportErrors(const std::vector<std::string>& filenames, const std::vector<cv::Size>& sizes);
+	};
+
+}
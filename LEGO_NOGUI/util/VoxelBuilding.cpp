@@ -3,38 +3,47 @@
 
 namespace util {
 
-	int VoxelBuilding::voxelCountSum(int height) {
+	int VoxelBuilding::voxelCountSum(int height) const {
 		int ans = 0;
-		for (auto voxel_node : node_stack[height]) {
-			ans += voxel_node->voxel_count;
+		for (int node : node_stack[height]) {
+			ans += nodes[node].voxel_count;
 		}
 		return ans;
 	}
 
+	/**
+	 * Remove the index-th node of the z-th slice of the node stack.
+	 * The children that lose all their parents are also removed recursively.
+	 */
 	void VoxelBuilding::removeNode(int z, int index) {
-		std::shared_ptr<VoxelNode> node = node_stack[z][index];
+		int node = node_stack[z][index];
 
-		for (auto it = node->children.begin(); it != node->children.end(); it++) {
-			it->first->parents.erase(node);
-			if (it->first->parents.size() == 0) {
-				removeNode(z + 1, it->first);
+		for (auto& child : nodes[node].children) {
+			removeEdge(nodes[child.node].parents, node);
+			if (nodes[child.node].parents.size() == 0) {
+				auto it = std::find(node_stack[z + 1].begin(), node_stack[z + 1].end(), child.node);
+				if (it != node_stack[z + 1].end()) {
+					removeNode(z + 1, it - node_stack[z + 1].begin());
+				}
 			}
 		}
 		
-		for (auto it = node->parents.begin(); it != node->parents.end(); it++) {
-			it->first->children.erase(node);
+		for (auto& parent : nodes[node].parents) {
+			removeEdge(nodes[parent.node].children, node);
 		}
 
+		nodes[node].parents.clear();
+		nodes[node].children.clear();
 		node_stack[z].erase(node_stack[z].begin() + index);
 	}
 
-	void VoxelBuilding::removeNode(int z, std::shared_ptr<VoxelNode> node) {
-		for (int i = 0; i < node_stack[z].size(); i++) {
-			if (node_stack[z][i] == node) {
-				removeNode(z, i);
+	void VoxelBuilding::removeEdge(std::vector<VoxelEdge>& edges, int node) {
+		for (int i = 0; i < edges.size(); i++) {
+			if (edges[i].node == node) {
+				edges.erase(edges.begin() + i);
 				break;
 			}
 		}
 	}
 
-}
\ No newline at end of file
+}
@@ -2,12 +2,27 @@
 
 #include <vector>
 #include <unordered_map>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include "BuildingLayer.h"
 #include "ContourUtils.h"
+#include "BitMask.h"
 
 namespace util {
 
+	/**
+	 * An edge of the voxel graph.
+	 */
+	class VoxelEdge {
+	public:
+		int node;			// index of the node in VoxelBuilding::nodes
+		int voxel_count;	// the number of the voxels shared by the two nodes in (x, y)
+
+	public:
+		VoxelEdge() {}
+		VoxelEdge(int node, int voxel_count) : node(node), voxel_count(voxel_count) {}
+	};
+
 	/**
 	 * This class represents the connected voxels in the slice.
 	 */
@@ -16,31 +31,38 @@ namespace util {
 		int cluster_id;		// cluster id (mainly for debug)
 		int height;
 		int voxel_count;
-		Polygon contour;
-		std::unordered_map<std::shared_ptr<VoxelNode>, bool> parents;
-		std::unordered_map<std::shared_ptr<VoxelNode>, bool> children;
+		std::shared_ptr<const Polygon> contour;	// shared with the raw footprints of the layers
+		BitMask mask;						// voxels of the node
+		std::vector<double> descendant_ious;	// IOU with the descendants (k + 1) slices above (negative - only the upper bound is known)
+		std::vector<VoxelEdge> parents;		// ordered by the node index
+		std::vector<VoxelEdge> children;	// ordered by the node index
 
 	public:
 		VoxelNode() {}
 		VoxelNode(int cluster_id, int height) : cluster_id(cluster_id), height(height) {}
-		VoxelNode(int cluster_id, int height, int voxel_count, const Polygon& contour) : cluster_id(cluster_id), height(height), voxel_count(voxel_count), contour(contour) {}
+		VoxelNode(int cluster_id, int height, int voxel_count, const Polygon& contour) : cluster_id(cluster_id), height(height), voxel_count(voxel_count), contour(std::make_shared<const Polygon>(contour)) {}
 	};
 
 	/**
 	 * Voxel representation of the building using the graph structure.
+	 * The nodes are stored in one array, and the node stack and the edges refer to them by index.
+	 * A removed node stays in the array, but it is not referred by the node stack or the edges any more.
 	 */
 	class VoxelBuilding {
 	public:
 		int building_id;
-		std::vector<std::vector<std::shared_ptr<VoxelNode>>> node_stack;
+		std::vector<VoxelNode> nodes;
+		std::vector<std::vector<int>> node_stack;
 
 	public:
 		VoxelBuilding() : building_id(-1) {}
 		VoxelBuilding(int building_id) : building_id(building_id) {}
 
-		int voxelCountSum(int height);
+		int voxelCountSum(int height) const;
 		void removeNode(int z, int index);
-		void removeNode(int z, std::shared_ptr<VoxelNode> node);
+
+	private:
+		static void removeEdge(std::vector<VoxelEdge>& edges, int node);
 	};
 
-}
\ No newline at end of file
+}
@@ -44,6 +44,11 @@ namespace voxel_model {
     }
     
     int voxel_model(std::vector<cv::Mat_<uchar>> &voxel_data, std::string output_ply_filename, double offset_x, double offset_y, double offset_z, double scale) {
+        // a voxel is occupied if its value is at least 128
+        return voxel_model(util::BinaryVolume(voxel_data, 127), output_ply_filename, offset_x, offset_y, offset_z, scale);
+    }
+    
+    int voxel_model(const util::BinaryVolume &volume, std::string output_ply_filename, double offset_x, double offset_y, double offset_z, double scale) {
         
         std::cout << "Doing debug voxel model." << std::endl;
         std::cout << "x offset\t" << offset_x << std::endl;
@@ -54,20 +59,18 @@ namespace voxel_model {
         std::vector<Point3d> vertices;
         std::vector<Triangle> faces;
         
-        uchar thresh=128;
-        int nslices = voxel_data.size();
+        int nslices = volume.depth;
         for (int k=0; k<nslices; k++) {
-            auto &mat = voxel_data[k];
-            for (int i=0; i<mat.rows; i++) {
-                for (int j=0; j<mat.cols; j++) {
+            for (int i=0; i<volume.height; i++) {
+                for (int j=0; j<volume.width; j++) {
                     
-					if (k>0 && k<nslices && i>0 && i<mat.rows - 1 && j>0 && j<mat.cols - 1)
-						if (voxel_data[k - 1](i, j) >= thresh && voxel_data[k + 1](i, j) >= thresh)
-							if (voxel_data[k](i - 1, j) >= thresh && voxel_data[k](i + 1, j) >= thresh)
-								if (voxel_data[k](i, j - 1) >= thresh && voxel_data[k](i, j + 1) >= thresh)
+					if (k>0 && k<nslices - 1 && i>0 && i<volume.height - 1 && j>0 && j<volume.width - 1)
+						if (volume.get(j, i, k - 1) && volume.get(j, i, k + 1))
+							if (volume.get(j, i - 1, k) && volume.get(j, i + 1, k))
+								if (volume.get(j - 1, i, k) && volume.get(j + 1, i, k))
                                     continue;
                     
-                    if (mat(i,j) >= thresh)
+                    if (volume.get(j, i, k))
                         put_voxel(j, i, k, vertices, faces);
                 }
             }
@@ -6,6 +6,7 @@
 #include <vector>
 #include <string>
 #include <opencv2/opencv.hpp>
+#include "util/BinaryVolume.h"
 
 namespace voxel_model {
 
@@ -30,5 +31,6 @@ namespace voxel_model {
 
 	void put_voxel(int x, int y, int z, std::vector<Point3d> &vertices, std::vector<Triangle> &faces);
 	int voxel_model(std::vector<cv::Mat_<uchar>> &voxel_data, std::string output_ply_filename, double offset_x, double offset_y, double offset_z, double scale);
+	int voxel_model(const util::BinaryVolume &volume, std::string output_ply_filename, double offset_x, double offset_y, double offset_z, double scale);
 
 }
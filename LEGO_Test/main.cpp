@@ -1,5 +1,7 @@
 #include <iostream>
+#include <chrono>
 #include "util/ContourUtils.h"
+#include "util/SummedAreaTable.h"
 #include "simp/RightAngleSimplification.h"
 #include "simp/CurveRightAngleSimplification.h"
 
@@ -71,6 +73,216 @@ void testSimplification(const char* filename) {
 	}
 }
 
+/**
+ * Return true if the rectangles of the polygon do not overlap each other and their total area equals the polygon area.
+ */
+bool isValidPartition(const util::Polygon& polygon) {
+	double area = cv::contourArea(polygon.contour.points);
+	for (int i = 0; i < polygon.holes.size(); i++) {
+		area -= cv::contourArea(polygon.holes[i].points);
+	}
+
+	std::vector<cv::Rect_<double>> rectangles;
+	double total_area = 0;
+	for (int i = 0; i < polygon.primitive_shapes.size(); i++) {
+		util::PrimitiveRectangle* rectangle = dynamic_cast<util::PrimitiveRectangle*>(polygon.primitive_shapes[i].get());
+		if (rectangle == NULL) return false;
+		rectangles.push_back(cv::Rect_<double>(cv::Point2d(rectangle->min_pt), cv::Point2d(rectangle->max_pt)));
+		total_area += rectangles.back().area();
+	}
+
+	for (int i = 0; i < rectangles.size(); i++) {
+		for (int j = i + 1; j < rectangles.size(); j++) {
+			if ((rectangles[i] & rectangles[j]).area() > 0) return false;
+		}
+	}
+
+	return std::abs(total_area - area) <= 1e-6 * std::max(1.0, area);
+}
+
+/**
+ * Compare the greedy decomposition and the minimum partition of the footprints simplified by the right angle algorithm
+ * for the time and the number of the rectangles, and check that both are valid partitions and that the minimum one
+ * has no more rectangles than the greedy one.
+ */
+void testDecomposition(const char* pattern) {
+	std::cout << "------------------------------------------------" << std::endl;
+	std::cout << "decomposition benchmark..." << std::endl;
+	std::cout << pattern << std::endl;
+
+	std::vector<cv::String> filenames;
+	cv::glob(pattern, filenames, true);
+
+	int num_polygons = 0;
+	int num_rectangles[2] = { 0, 0 };
+	double elapsed[2] = { 0, 0 };
+	int num_invalid[2] = { 0, 0 };
+	int num_more_than_greedy = 0;
+	int num_fallbacks = 0;
+	for (int i = 0; i < filenames.size(); i++) {
+		cv::Mat img = cv::imread(filenames[i], cv::IMREAD_GRAYSCALE);
+		std::vector<util::Polygon> polygons = util::findContours(img, false);
+
+		for (int j = 0; j < polygons.size(); j++) {
+			util::Polygon simplified_polygon;
+			try {
+				simplified_polygon = simp::RightAngleSimplification::simplify(polygons[j], 20, 0, 0.02, true);
+			}
+			catch (...) {
+				continue;
+			}
+			num_polygons++;
+
+			int counts[2];
+			for (int k = 0; k < 2; k++) {
+				util::Polygon polygon = simplified_polygon;
+				auto start = std::chrono::high_resolution_clock::now();
+				bool as_requested = simp::RightAngleSimplification::decomposePolygon(polygon, k == 1);
+				elapsed[k] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+				counts[k] = polygon.primitive_shapes.size();
+				num_rectangles[k] += counts[k];
+
+				if (!as_requested) num_fallbacks++;
+				if (!isValidPartition(polygon)) {
+					num_invalid[k]++;
+					std::cout << "invalid " << (k == 0 ? "greedy" : "minimum") << " partition: " << filenames[i] << ", polygon " << j << std::endl;
+				}
+			}
+			if (counts[1] > counts[0]) {
+				num_more_than_greedy++;
+				std::cout << "minimum partition has more rectangles than greedy: " << filenames[i] << ", polygon " << j << std::endl;
+			}
+		}
+	}
+
+	std::cout << "#slices: " << filenames.size() << ", #polygons: " << num_polygons << std::endl;
+	std::cout << "greedy:  " << num_rectangles[0] << " rectangles, " << elapsed[0] << " ms" << std::endl;
+	std::cout << "minimum: " << num_rectangles[1] << " rectangles, " << elapsed[1] << " ms" << std::endl;
+	std::cout << "invalid partitions: greedy " << num_invalid[0] << ", minimum " << num_invalid[1] << std::endl;
+	std::cout << "minimum > greedy: " << num_more_than_greedy << ", fallbacks to greedy: " << num_fallbacks << std::endl;
+}
+
+/**
+ * Check that the summed-area table gives the same IOU as rasterizing the contour for the footprints simplified by
+ * the right angle algorithm, their one-pixel coordinate moves, and their scaled bounding boxes including mirrored ones
+ * and ones clipped by the image. Also check that optimizeVertices(), which accumulates the strips of the table
+ * over its moves, returns the IOU of its result.
+ */
+void testSummedAreaTable(const char* pattern) {
+	std::cout << "------------------------------------------------" << std::endl;
+	std::cout << "summed-area table testing..." << std::endl;
+	std::cout << pattern << std::endl;
+
+	std::vector<cv::String> filenames;
+	cv::glob(pattern, filenames, true);
+
+	int num_checked = 0;
+	int num_mismatches = 0;
+	for (int i = 0; i < filenames.size(); i++) {
+		cv::Mat img = cv::imread(filenames[i], cv::IMREAD_GRAYSCALE);
+		std::vector<util::Polygon> polygons = util::findContours(img, false);
+
+		for (int j = 0; j < polygons.size(); j++) {
+			util::Polygon simplified_polygon;
+			try {
+				simplified_polygon = simp::RightAngleSimplification::simplify(polygons[j], 20, 0, 0.02, true);
+			}
+			catch (...) {
+				continue;
+			}
+
+			// the simplified contour is rectilinear in its own frame, to which the input contour is transformed
+			util::Affine inv = simplified_polygon.contour.mat.inv();
+			util::Ring actual_contour = polygons[j].contour.getActualPoints();
+			std::vector<cv::Point> contour(actual_contour.size());
+			for (int k = 0; k < actual_contour.size(); k++) {
+				cv::Point2f pt = inv * actual_contour[k];
+				contour[k] = cv::Point(std::round(pt.x), std::round(pt.y));
+			}
+			std::vector<cv::Point> simplified_contour(simplified_polygon.contour.size());
+			for (int k = 0; k < simplified_polygon.contour.size(); k++) {
+				simplified_contour[k] = cv::Point(std::round(simplified_polygon.contour[k].x), std::round(simplified_polygon.contour[k].y));
+			}
+			if (!util::isSimple(simplified_contour)) continue;
+
+			cv::Rect bbox = cv::boundingRect(contour) | cv::boundingRect(simplified_contour);
+			cv::Rect simplified_bbox = cv::boundingRect(simplified_contour);
+			if (simplified_bbox.width <= 1 || simplified_bbox.height <= 1) continue;
+
+			// the image has a margin of 100 pixels as in optimizeBBox()
+			cv::Mat_<uchar> contour_img;
+			util::createImageFromContour(bbox.width + 200, bbox.height + 200, contour, cv::Point(100 - bbox.x, 100 - bbox.y), contour_img);
+			util::SummedAreaTable table(contour_img, cv::Point(bbox.x - 100, bbox.y - 100));
+
+			auto check = [&](const std::vector<cv::Point>& proposed_contour, const char* name) {
+				num_checked++;
+				double iou = table.calculateIOU(proposed_contour);
+				double raster_iou = table.rasterIOU(proposed_contour);
+				if (std::abs(iou - raster_iou) > 1e-9) {
+					num_mismatches++;
+					std::cout << name << ": " << iou << " vs " << raster_iou << " (" << filenames[i] << ", polygon " << j << ")" << std::endl;
+				}
+			};
+
+			check(simplified_contour, "simplified contour");
+
+			// one-pixel moves of each coordinate as in optimizeVertices()
+			std::map<int, int> x_map;
+			std::map<int, int> y_map;
+			for (int k = 0; k < simplified_contour.size(); k++) {
+				x_map[simplified_contour[k].x] = simplified_contour[k].x;
+				y_map[simplified_contour[k].y] = simplified_contour[k].y;
+			}
+			for (int d = -1; d <= 1; d += 2) {
+				for (auto it = x_map.begin(); it != x_map.end(); it++) {
+					std::map<int, int> proposed_x_map = x_map;
+					proposed_x_map[it->first] += d;
+					check(simp::RightAngleSimplification::proposedContour(simplified_contour, proposed_x_map, y_map), "vertex move");
+				}
+				for (auto it = y_map.begin(); it != y_map.end(); it++) {
+					std::map<int, int> proposed_y_map = y_map;
+					proposed_y_map[it->first] += d;
+					check(simp::RightAngleSimplification::proposedContour(simplified_contour, x_map, proposed_y_map), "vertex move");
+				}
+			}
+
+			// scaled bounding boxes, which are mirrored when the new corners are swapped and clipped when they go beyond the margin
+			int x1 = simplified_bbox.x;
+			int x2 = simplified_bbox.x + simplified_bbox.width - 1;
+			int y1 = simplified_bbox.y;
+			int y2 = simplified_bbox.y + simplified_bbox.height - 1;
+			int w = x2 - x1;
+			int h = y2 - y1;
+			std::vector<cv::Vec4i> new_bboxes = {
+				cv::Vec4i(x1 - 3, x2 + 3, y1 + 2, y2 - 2),
+				cv::Vec4i(x2, x1, y1, y2),
+				cv::Vec4i(x1, x2, y2, y1),
+				cv::Vec4i(x2 + 5, x1 - 5, y2, y1),
+				cv::Vec4i(x1 - w - 200, x2 + w + 200, y1 - h - 200, y2 + h + 200),
+				cv::Vec4i(x2 + 300, x1 - 150, y1 + h / 2, y2 + h + 300),
+				cv::Vec4i(x1 - 2 * w - 400, x1 - w - 300, y1, y2)
+			};
+			for (auto& new_bbox : new_bboxes) {
+				check(simp::RightAngleSimplification::proposedBBox(simplified_contour, x1, x2, y1, y2, new_bbox[0], new_bbox[1], new_bbox[2], new_bbox[3]), "bounding box");
+			}
+
+			// optimizeVertices() uses the image of the bounding box of both contours without any margin
+			std::vector<cv::Point> optimized_contour = simplified_contour;
+			double score = simp::RightAngleSimplification::optimizeVertices(contour, optimized_contour);
+			cv::Mat_<uchar> tight_img;
+			util::createImageFromContour(bbox.width, bbox.height, contour, cv::Point(-bbox.x, -bbox.y), tight_img);
+			util::SummedAreaTable tight_table(tight_img, cv::Point(bbox.x, bbox.y));
+			num_checked++;
+			if (std::abs(score - tight_table.rasterIOU(optimized_contour)) > 1e-9) {
+				num_mismatches++;
+				std::cout << "optimizeVertices: " << score << " vs " << tight_table.rasterIOU(optimized_contour) << " (" << filenames[i] << ", polygon " << j << ")" << std::endl;
+			}
+		}
+	}
+
+	std::cout << "#checked: " << num_checked << ", #mismatches: " << num_mismatches << std::endl;
+}
+
 int main() {
 	testApproxPolyDP("complex_contour.png");
 
@@ -88,5 +300,8 @@ int main() {
 	testSimplification("simplify_test3.png");
 	testSimplification("simplify_test4.png");
 
+	testSummedAreaTable("../data/*.png");
+	testDecomposition("../data/*.png");
+
 	return 0;
 }
\ No newline at end of file
@@ -10,7 +10,7 @@ import json
 import subprocess
 import sys
 
-def main(data_dir, weight, algorithm, output_dir):
+def main(data_dir, weight, algorithm, output_dir, use_lvox):
 	# Create the output directory if not exists
 	if not os.path.exists(output_dir):
 		os.mkdir(output_dir)
@@ -29,6 +29,13 @@ def main(data_dir, weight, algorithm, output_dir):
 		output_obj_path = cur_path + "/" + output_dir + "/" + cluster_folder + "_building.obj"
 		output_topface_path = cur_path + "/" + output_dir + "/" + cluster_folder + "_building.txt"
 		
+		# convert the slices into a single volume file once, so that the following runs do not decode the slices again
+		if use_lvox:
+			lvox_path = cur_path + "/" + cluster_path + "/volume.lvox"
+			if not os.path.exists(lvox_path):
+				subprocess.call(["cgv/LEGO_NOGUI", "--lvox", intput_file_path, lvox_path, str(metadata["position"][0]), str(metadata["position"][1]), "0", str(metadata["voxel_size"])], cwd = "cgv")
+			intput_file_path = lvox_path
+		
 		# run cgv tool
 		subprocess.call(["cgv/LEGO_NOGUI", intput_file_path, weight, algorithm, str(metadata["position"][0]), str(metadata["position"][1]), "0", str(metadata["voxel_size"]), output_obj_path, output_topface_path], cwd = "cgv")
 
@@ -38,10 +45,11 @@ if __name__ == "__main__":
 	parser.add_argument("weight", help="weight (0 - 1)")
 	parser.add_argument("algorithm", help="algorithm option (1 - All, 2 - DP)")
 	parser.add_argument("output_dir", help="path to folder to save the output")
+	parser.add_argument("--lvox", action="store_true", help="cache the slices of each cluster in a .lvox file")
 	args = parser.parse_args()
 	
 	if not os.path.exists(args.data_dir):
 		print("Directory not found: " + args.data_dir)
 		sys.exit(0)
 
-	main(args.data_dir, args.weight, args.algorithm, args.output_dir)
\ No newline at end of file
+	main(args.data_dir, args.weight, args.algorithm, args.output_dir, args.lvox)
\ No newline at end of file